@@ -0,0 +1,32 @@
+#include "Camera.h"
+#include "Config.h"
+#include <algorithm>
+
+void Camera::pan(glm::vec2 worldOffset)
+{
+    _center += worldOffset;
+
+    // Keep some of the grid on screen
+    _center = glm::clamp(_center, glm::vec2(-1.0f), glm::vec2(1.0f));
+}
+
+void Camera::zoomAt(glm::vec2 worldPos, float factor)
+{
+    float zoom = std::min(std::max(_zoom * factor, CAMERA_MIN_ZOOM), CAMERA_MAX_ZOOM);
+    _center = worldPos - (worldPos - _center) * (_zoom / zoom);
+    _zoom = zoom;
+    pan(glm::vec2(0.0f));
+}
+
+void Camera::reset()
+{
+    _center = glm::vec2(0.0f);
+    _zoom = 1.0f;
+}
+
+glm::vec2 Camera::screenToWorld(double screenX, double screenY, int screenWidth, int screenHeight)
+{
+    // Screen y grows downwards, NDC y upwards
+    glm::vec2 ndc((float)(screenX / screenWidth) * 2.0f - 1.0f, 1.0f - (float)(screenY / screenHeight) * 2.0f);
+    return ndc / _zoom + _center;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// 2D view over the grid. World space is the grid mapped to [-1, 1] like the instance positions,
+// the shaders compute clip = (world - center) * zoom.
+class Camera
+{
+public:
+	void pan(glm::vec2 worldOffset);
+	void zoomAt(glm::vec2 worldPos, float factor); // Keeps worldPos under the same screen point
+	void reset();
+
+	glm::vec2 screenToWorld(double screenX, double screenY, int screenWidth, int screenHeight);
+	glm::vec2 getCenter() { return _center; }
+	float getZoom() { return _zoom; }
+
+	// World rectangle covered by the viewport
+	glm::vec2 getVisibleMin() { return _center - glm::vec2(1.0f / _zoom); }
+	glm::vec2 getVisibleMax() { return _center + glm::vec2(1.0f / _zoom); }
+
+private:
+	glm::vec2 _center = glm::vec2(0.0f);
+	float _zoom = 1.0f;
+};
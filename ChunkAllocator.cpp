@@ -0,0 +1,246 @@
+#include "ChunkAllocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    const size_t BLOCK_ALIGNMENT = 64; // Keep blocks on their own cache lines
+
+    // Slots of exited threads are reused, so pools that come and go keep getting caches. A cache
+    // keeps its blocks when its thread exits, the next thread on the slot takes them over.
+    std::mutex slotMutex;
+    std::vector<int> freeSlots;
+    int nextThreadSlot = 0;
+
+    struct ThreadSlot
+    {
+        int slot = -1;
+        ~ThreadSlot()
+        {
+            if (slot < 0) { return; }
+            std::lock_guard<std::mutex> lock(slotMutex);
+            freeSlots.push_back(slot);
+        }
+    };
+    thread_local ThreadSlot threadSlot;
+
+    int getThreadSlot()
+    {
+        if (threadSlot.slot < 0) {
+            std::lock_guard<std::mutex> lock(slotMutex);
+            if (freeSlots.empty()) { threadSlot.slot = nextThreadSlot++; }
+            else {
+                // Lowest first, those are the ones below MAX_THREAD_CACHES
+                std::vector<int>::iterator lowest = std::min_element(freeSlots.begin(), freeSlots.end());
+                threadSlot.slot = *lowest;
+                freeSlots.erase(lowest);
+            }
+        }
+        return threadSlot.slot;
+    }
+}
+
+ChunkAllocator::ChunkAllocator(size_t blockSize, bool useHugePages)
+    : _liveBlocks(0), _highWaterBlocks(0), _uncachedCalls(0)
+{
+    _blockSize = (blockSize + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+    _slabSize = (_blockSize + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    _useHugePages = useHugePages;
+}
+
+ChunkAllocator::~ChunkAllocator()
+{
+    for (const Slab& slab : _slabs) {
+        unmapSlab(slab);
+    }
+}
+
+void* ChunkAllocator::allocate()
+{
+    FreeBlock* block;
+    int slot = getThreadSlot();
+
+    if (slot < MAX_THREAD_CACHES) {
+        ThreadCache& cache = _caches[slot];
+        if (cache.head == nullptr) { refillCache(cache); }
+
+        block = cache.head;
+        cache.head = block->next;
+        cache.count--;
+    }
+    else {
+        std::lock_guard<std::mutex> lock(_mutex);
+        block = popShared();
+        _uncachedCalls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t live = _liveBlocks.fetch_add(1, std::memory_order_relaxed) + 1;
+    size_t highWater = _highWaterBlocks.load(std::memory_order_relaxed);
+    while (live > highWater && !_highWaterBlocks.compare_exchange_weak(highWater, live, std::memory_order_relaxed)) {}
+
+    return block;
+}
+
+void ChunkAllocator::release(void* memory)
+{
+    if (memory == nullptr) { return; }
+
+    FreeBlock* block = static_cast<FreeBlock*>(memory);
+    int slot = getThreadSlot();
+
+    if (slot < MAX_THREAD_CACHES) {
+        ThreadCache& cache = _caches[slot];
+        block->next = cache.head;
+        cache.head = block;
+        cache.count++;
+
+        if (cache.count > CACHE_LIMIT) { drainCache(cache, CACHE_LIMIT - CACHE_BATCH); }
+    }
+    else {
+        std::lock_guard<std::mutex> lock(_mutex);
+        pushShared(block);
+        _uncachedCalls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    _liveBlocks.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ChunkAllocator::reserve(size_t blockCount)
+{
+    size_t blocksPerSlab = _slabSize / _blockSize;
+    std::lock_guard<std::mutex> lock(_mutex);
+    _slabs.reserve((blockCount + blocksPerSlab - 1) / blocksPerSlab);
+}
+
+ChunkAllocator::Stats ChunkAllocator::getStats() const
+{
+    Stats stats;
+    stats.blockSize = _blockSize;
+    stats.liveBlocks = _liveBlocks.load(std::memory_order_relaxed);
+    stats.liveBytes = stats.liveBlocks * _blockSize;
+    stats.highWaterBlocks = _highWaterBlocks.load(std::memory_order_relaxed);
+    stats.highWaterBytes = stats.highWaterBlocks * _blockSize;
+    stats.uncachedCalls = _uncachedCalls.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    stats.slabCount = _slabs.size();
+    for (const Slab& slab : _slabs) {
+        stats.reservedBytes += slab.size;
+        if (slab.hugePages) { stats.hugePageSlabs++; }
+    }
+    return stats;
+}
+
+ChunkAllocator::FreeBlock* ChunkAllocator::popShared()
+{
+    if (_sharedHead == nullptr) { addSlab(); }
+
+    FreeBlock* block = _sharedHead;
+    _sharedHead = block->next;
+    return block;
+}
+
+void ChunkAllocator::pushShared(FreeBlock* block)
+{
+    block->next = _sharedHead;
+    _sharedHead = block;
+}
+
+void ChunkAllocator::refillCache(ThreadCache& cache)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t i = 0; i < CACHE_BATCH; ++i) {
+        FreeBlock* block = popShared();
+        block->next = cache.head;
+        cache.head = block;
+        cache.count++;
+
+        if (_sharedHead == nullptr) { break; } // Don't map a new slab just to fill the batch
+    }
+}
+
+void ChunkAllocator::drainCache(ThreadCache& cache, size_t keep)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    while (cache.count > keep) {
+        FreeBlock* block = cache.head;
+        cache.head = block->next;
+        cache.count--;
+        pushShared(block);
+    }
+}
+
+void ChunkAllocator::addSlab()
+{
+    Slab slab;
+    slab.size = _slabSize;
+    slab.memory = mapSlab(slab.size, slab.hugePages);
+    if (slab.memory == nullptr) { throw std::bad_alloc(); }
+    _slabs.push_back(slab);
+
+    // Thread the new blocks onto the shared list in address order
+    char* base = static_cast<char*>(slab.memory);
+    size_t blockCount = slab.size / _blockSize;
+    for (size_t i = blockCount; i-- > 0;) {
+        pushShared(reinterpret_cast<FreeBlock*>(base + i * _blockSize));
+    }
+}
+
+void* ChunkAllocator::mapSlab(size_t size, bool& hugePages)
+{
+    hugePages = false;
+
+#ifdef _WIN32
+    void* memory = nullptr;
+    if (_useHugePages) {
+        // Needs SeLockMemoryPrivilege, falls back to regular pages without it
+        SIZE_T largePage = GetLargePageMinimum();
+        if (largePage != 0 && size % largePage == 0) {
+            memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            hugePages = (memory != nullptr);
+        }
+    }
+    if (memory == nullptr) {
+        memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    }
+    return memory;
+#else
+    // Over-map and trim so the slab starts on a huge page boundary
+    size_t mappedSize = size + HUGE_PAGE_SIZE;
+    void* mapped = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) { return nullptr; }
+
+    uintptr_t start = reinterpret_cast<uintptr_t>(mapped);
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+    if (aligned > start) { munmap(mapped, aligned - start); }
+    size_t tail = (start + mappedSize) - (aligned + size);
+    if (tail > 0) { munmap(reinterpret_cast<void*>(aligned + size), tail); }
+
+#ifdef MADV_HUGEPAGE
+    if (_useHugePages) {
+        hugePages = (madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE) == 0);
+    }
+#endif
+    return reinterpret_cast<void*>(aligned);
+#endif
+}
+
+void ChunkAllocator::unmapSlab(const Slab& slab)
+{
+#ifdef _WIN32
+    VirtualFree(slab.memory, 0, MEM_RELEASE);
+#else
+    munmap(slab.memory, slab.size);
+#endif
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Fixed-size block allocator for simulation chunks.
+// Blocks are carved out of 2 MB slabs (huge-page backed when the OS allows it)
+// and recycled through per-thread free lists, so chunks can wake, sleep, load
+// and unload without touching the heap once the slabs are warm. A thread hands
+// its cache slot back when it exits; only threads beyond MAX_THREAD_CACHES alive
+// at once share the locked list.
+class ChunkAllocator
+{
+public:
+	static const int MAX_THREAD_CACHES = 64;
+
+	struct Stats
+	{
+		size_t blockSize = 0;
+		size_t liveBlocks = 0;
+		size_t liveBytes = 0;
+		size_t highWaterBlocks = 0;
+		size_t highWaterBytes = 0;
+		size_t reservedBytes = 0;
+		size_t slabCount = 0;
+		size_t hugePageSlabs = 0;
+		size_t uncachedCalls = 0; // allocate/release calls from threads without a cache slot
+	};
+
+	ChunkAllocator(size_t blockSize, bool useHugePages = true);
+	~ChunkAllocator();
+
+	ChunkAllocator(const ChunkAllocator&) = delete;
+	ChunkAllocator& operator=(const ChunkAllocator&) = delete;
+
+	void* allocate();
+	void release(void* block);
+	void reserve(size_t blockCount); // Pre-size bookkeeping so growing up to blockCount never hits the heap
+
+	size_t getBlockSize() const { return _blockSize; }
+	Stats getStats() const;
+
+private:
+	static const size_t CACHE_BATCH = 16;
+	static const size_t CACHE_LIMIT = 64;
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	struct ThreadCache
+	{
+		FreeBlock* head = nullptr;
+		size_t count = 0;
+		char padding[64 - sizeof(FreeBlock*) - sizeof(size_t)]; // One cache line per thread
+	};
+
+	struct Slab
+	{
+		void* memory;
+		size_t size;
+		bool hugePages;
+	};
+
+	size_t _blockSize;
+	size_t _slabSize;
+	bool _useHugePages;
+
+	ThreadCache _caches[MAX_THREAD_CACHES];
+
+	mutable std::mutex _mutex; // Guards everything below
+	FreeBlock* _sharedHead = nullptr;
+	std::vector<Slab> _slabs;
+
+	std::atomic<size_t> _liveBlocks;
+	std::atomic<size_t> _highWaterBlocks;
+	std::atomic<size_t> _uncachedCalls;
+
+	FreeBlock* popShared();
+	void pushShared(FreeBlock* block);
+	void refillCache(ThreadCache& cache);
+	void drainCache(ThreadCache& cache, size_t keep);
+	void addSlab();
+	void* mapSlab(size_t size, bool& hugePages);
+	void unmapSlab(const Slab& slab);
+};
@@ -0,0 +1,52 @@
+#include "CommandLine.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+bool parseName(const char* text, const char* what, const char* const* names, int count, int& value)
+{
+    std::vector<int> values;
+    if (!parseNames(text, what, names, count, values)) { return false; }
+    if (values.size() != 1) {
+        std::cerr << "Error: One " << what << " only, got " << text << "\n";
+        return false;
+    }
+    value = values[0];
+    return true;
+}
+
+bool parseNames(const char* text, const char* what, const char* const* names, int count, std::vector<int>& values)
+{
+    values.clear();
+    std::string list = text;
+    for (size_t start = 0; start <= list.size();) {
+        size_t end = std::min(list.find(',', start), list.size());
+        std::string name = list.substr(start, end - start);
+        int index = 0;
+        while (index < count && name != names[index]) { ++index; }
+        if (index == count) {
+            std::cerr << "Error: Unknown " << what << " " << name << ", one of:";
+            for (int i = 0; i < count; ++i) { std::cerr << " " << names[i]; }
+            std::cerr << "\n";
+            return false;
+        }
+        values.push_back(index);
+        start = end + 1;
+    }
+    return true;
+}
+
+bool parseList(const char* text, std::vector<int>& values)
+{
+    values.clear();
+    for (const char* part = text; *part != '\0';) {
+        char* end;
+        long value = std::strtol(part, &end, 10);
+        if (end == part || value <= 0) { return false; }
+        values.push_back((int)value);
+        part = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') { return false; }
+    }
+    return !values.empty();
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+// Option values shared by the command line modes. Names are stored as their index into names,
+// an unknown one is reported on stderr with the valid ones; what names the kind ("scenario",
+// "engine") in that message.
+
+// One name
+bool parseName(const char* text, const char* what, const char* const* names, int count, int& value);
+
+// Comma separated names
+bool parseNames(const char* text, const char* what, const char* const* names, int count, std::vector<int>& values);
+
+// Comma separated positive integers
+bool parseList(const char* text, std::vector<int>& values);
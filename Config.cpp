@@ -3,6 +3,31 @@
 const GLenum TOGGLE_POLYGON_KEY = GLFW_KEY_Q;
 const int WINDOW_WIDTH = 920;
 const int WINDOW_HEIGHT = 920;
+const float CLEAR_COLOR[4] = { 0.2f, 0.3f, 0.2f, 1.0f };
 const int SIMULATION_INTERVAL_IN_FRAMES = 3;
+const bool USE_HUGE_PAGES = true;
+const size_t FRAME_ARENA_SIZE = 64 * 1024;
+const int STEADY_STATE_WARMUP_FRAMES = 120;
+const char* MEMORY_REPORT_PATH = "memory_report.json";
+const char* BENCHMARK_REPORT_PATH = "benchmark_report.json";
+const char* MICROBENCH_REPORT_PATH = "microbench_report.json";
+const char* SWEEP_REPORT_PATH = "sweep_report.csv";
+const char* SWEEP_CHART_PATH = "sweep_report.html";
+const char* SHADER_CACHE_DIR = "shader_cache";
+const float CAMERA_MIN_ZOOM = 0.1f;
+const float CAMERA_MAX_ZOOM = 32.0f;
+const float CAMERA_ZOOM_STEP = 1.1f; // Per scroll wheel notch
+const float CAMERA_PAN_STEP = 0.02f; // Screen fraction per frame with the arrow keys
+const int CAMERA_RESET_KEY = GLFW_KEY_HOME;
+const int CAPTURE_KEY = GLFW_KEY_F9; // Starts and stops recording
+const char* CAPTURE_PATH = "capture.y4m"; // .y4m for one video stream, anything else is a PNG prefix
+const int CAPTURE_READBACK_BUFFERS = 4; // Frames a capture may spend on the GPU and in the encoder before it stalls
+const int TRACE_KEY = GLFW_KEY_F10; // Writes the next TRACE_FRAMES frames to TRACE_PATH
+const char* TRACE_PATH = "trace.json"; // Chrome Trace Event JSON, opens in ui.perfetto.dev
+const int TRACE_FRAMES = 300;
+const int IDLE_REDRAW_FRAMES = 3; // Frames still drawn after the last change, ImGui lags input by a frame
+const double IDLE_WAIT_SECONDS = 0.25; // Longest sleep in glfwWaitEventsTimeout while nothing changes
+const double UNFOCUSED_FRAME_RATE = 10.0;
+const float FRAME_BUDGET_MS = 1000.0f / 60.0f; // Budget line of the profiler graph
 int BRUSH_SIZE = 30;
 float BRUSH_DENSITY = 0.01f;
\ No newline at end of file
@@ -1,14 +1,50 @@
 #pragma once
 
 #include <GLFW/glfw3.h>
+#include <cstddef>
 
 // Need to know in compile time
 #define SIMULATION_GRID_WIDTH 460
 #define SIMULATION_GRID_HEIGHT 460
 
+// Grid is stored as square chunks of 2^SHIFT tiles per side
+#define SIMULATION_CHUNK_SHIFT 6
+#define SIMULATION_CHUNK_SIZE (1 << SIMULATION_CHUNK_SHIFT)
+
+// Longest cycle of grid states the simulation still treats as settled, in ticks
+#define SIMULATION_SETTLE_PERIOD 8
+
+// Ticks moving more than 1/FRACTION of the grid's cells leave the state hash out, see Simulation::StateHashing
+#define SIMULATION_HASH_MOVE_FRACTION 64
+
 extern const GLenum TOGGLE_POLYGON_KEY;
 extern const int WINDOW_WIDTH;
 extern const int WINDOW_HEIGHT;
+extern const float CLEAR_COLOR[4];
 extern const int SIMULATION_INTERVAL_IN_FRAMES;
+extern const bool USE_HUGE_PAGES;
+extern const size_t FRAME_ARENA_SIZE;
+extern const int STEADY_STATE_WARMUP_FRAMES;
+extern const char* MEMORY_REPORT_PATH;
+extern const char* BENCHMARK_REPORT_PATH;
+extern const char* MICROBENCH_REPORT_PATH;
+extern const char* SWEEP_REPORT_PATH;
+extern const char* SWEEP_CHART_PATH;
+extern const char* SHADER_CACHE_DIR;
+extern const float CAMERA_MIN_ZOOM;
+extern const float CAMERA_MAX_ZOOM;
+extern const float CAMERA_ZOOM_STEP;
+extern const float CAMERA_PAN_STEP;
+extern const int CAMERA_RESET_KEY;
+extern const int CAPTURE_KEY;
+extern const char* CAPTURE_PATH;
+extern const int CAPTURE_READBACK_BUFFERS;
+extern const int TRACE_KEY;
+extern const char* TRACE_PATH;
+extern const int TRACE_FRAMES;
+extern const int IDLE_REDRAW_FRAMES;
+extern const double IDLE_WAIT_SECONDS;
+extern const double UNFOCUSED_FRAME_RATE;
+extern const float FRAME_BUDGET_MS;
 extern int BRUSH_SIZE;
 extern float BRUSH_DENSITY;
@@ -0,0 +1,247 @@
+#include "Determinism.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
+#include "ChunkAllocator.h"
+#include "CommandLine.h"
+#include "Config.h"
+#include "Simulation.h"
+#include "Scenario.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Plays a scenario from setUp() on the given engine, keeping the grid hash after each tick. With
+    // expected hashes it stops after the first tick that differs and returns it, otherwise 0.
+    int play(Simulation& sim, Simulation::Engine engine, ThreadPool* pool, int scenario, const DeterminismOptions& options,
+        int ticks, const std::vector<uint64_t>* expected, std::vector<uint64_t>& hashes)
+    {
+        sim.setEngine(engine, pool);
+        sim.setStateHashing(Simulation::HASHING_ALWAYS); // Compared on every tick, not only while settling
+        Scenario workload((Scenario::Id)scenario, options.seed);
+        workload.setUp(sim);
+
+        hashes.clear();
+        hashes.reserve(ticks);
+        int diverged = 0;
+        for (int tick = 1; tick <= ticks && diverged == 0; ++tick) {
+            workload.update(sim);
+            sim.step();
+            hashes.push_back(sim.getStateHash());
+            if (expected != nullptr && (*expected)[tick - 1] != hashes.back()) { diverged = tick; }
+        }
+        sim.setEngine(engine, nullptr); // The pool may not outlive the call
+        return diverged;
+    }
+
+    // Grid state after a given tick, played again from the start
+    void replay(Simulation& sim, Simulation::Engine engine, ThreadPool* pool, int scenario, const DeterminismOptions& options, int tick)
+    {
+        std::vector<uint64_t> hashes;
+        play(sim, engine, pool, scenario, options, tick, nullptr, hashes);
+    }
+
+    // Pools live for the whole check, one per worker count, nullptr for the serial engine
+    typedef std::map<int, std::unique_ptr<ThreadPool>> PoolMap;
+
+    ThreadPool* getPool(PoolMap& pools, Simulation::Engine engine, int workers)
+    {
+        if (engine != Simulation::ENGINE_STRIPED) { return nullptr; }
+        std::unique_ptr<ThreadPool>& pool = pools[workers];
+        if (!pool) { pool.reset(new ThreadPool(workers)); }
+        return pool.get();
+    }
+
+    // The grid hash is kept by every tile write, a sum over the cells that no longer matches it is a missed write
+    bool hashMatchesCells(Simulation& sim)
+    {
+        uint64_t sum = 0;
+        for (int chunkY = 0; chunkY < sim.getChunksY(); ++chunkY) {
+            for (int chunkX = 0; chunkX < sim.getChunksX(); ++chunkX) { sum += sim.getChunkHash(chunkX, chunkY); }
+        }
+        return sum == sim.getStateHash();
+    }
+
+    // Worker threads come and go with their pools. Many more of them than the allocator has caches,
+    // one pool after another, must all still get a cache instead of falling back to its lock.
+    bool checkThreadCaches()
+    {
+        const int POOL_THREADS = 4; // The caller plus 3 workers
+        const int POOLS = ChunkAllocator::MAX_THREAD_CACHES / (POOL_THREADS - 1) + 8;
+        ChunkAllocator allocator(64, false);
+        for (int i = 0; i < POOLS; ++i) {
+            ThreadPool pool(POOL_THREADS);
+            pool.parallelFor(POOL_THREADS, [&allocator](int begin, int end) {
+                for (int item = begin; item < end; ++item) { allocator.release(allocator.allocate()); }
+            });
+        }
+        return allocator.getStats().uncachedCalls == 0;
+    }
+
+    // Where two grids at the same tick differ: how many chunks, the cells they cover and the first cell
+    std::string describeDifference(Simulation& reference, Simulation& other)
+    {
+        int chunks = 0, firstX = -1, firstY = -1;
+        int minX = reference.getChunksX(), minY = reference.getChunksY(), maxX = -1, maxY = -1;
+        for (int chunkY = 0; chunkY < reference.getChunksY(); ++chunkY) {
+            for (int chunkX = 0; chunkX < reference.getChunksX(); ++chunkX) {
+                if (reference.getChunkHash(chunkX, chunkY) == other.getChunkHash(chunkX, chunkY)) { continue; }
+                if (chunks++ == 0) { firstX = chunkX; firstY = chunkY; }
+                minX = std::min(minX, chunkX);
+                minY = std::min(minY, chunkY);
+                maxX = std::max(maxX, chunkX);
+                maxY = std::max(maxY, chunkY);
+            }
+        }
+        if (chunks == 0) { return "no chunk differs, the grid hashes drifted"; }
+
+        int startX = firstX * SIMULATION_CHUNK_SIZE, startY = firstY * SIMULATION_CHUNK_SIZE;
+        int endX = std::min(startX + SIMULATION_CHUNK_SIZE, reference.getWidth()), endY = std::min(startY + SIMULATION_CHUNK_SIZE, reference.getHeight());
+        int cellX = -1, cellY = -1;
+        for (int y = startY; y < endY && cellX < 0; ++y) {
+            for (int x = startX; x < endX; ++x) {
+                if (reference.getTile(x, y) != other.getTile(x, y)) {
+                    cellX = x;
+                    cellY = y;
+                    break;
+                }
+            }
+        }
+
+        char text[320];
+        std::snprintf(text, sizeof(text), "%d chunk(s) differ within cells %d,%d to %d,%d, first chunk %d,%d, first cell %d,%d: %s, %s in the reference",
+            chunks, minX * SIMULATION_CHUNK_SIZE, minY * SIMULATION_CHUNK_SIZE,
+            std::min((maxX + 1) * SIMULATION_CHUNK_SIZE, reference.getWidth()) - 1, std::min((maxY + 1) * SIMULATION_CHUNK_SIZE, reference.getHeight()) - 1,
+            firstX, firstY, cellX, cellY, other.getTileName(other.getTile(cellX, cellY)), reference.getTileName(reference.getTile(cellX, cellY)));
+        return text;
+    }
+}
+
+bool DeterminismOptions::parse(int argc, char** argv)
+{
+    width = SIMULATION_GRID_WIDTH;
+    height = SIMULATION_GRID_HEIGHT;
+    for (int id = 0; id < Scenario::SCENARIO_COUNT; ++id) { scenarios.push_back(id); }
+    for (int engine = 0; engine < Simulation::ENGINE_COUNT; ++engine) { engines.push_back(engine); }
+    int cores = std::max(4, (int)std::thread::hardware_concurrency()); // Oversubscribed is fine, only the results matter
+    for (int workers = 1; workers < cores; workers *= 2) { threads.push_back(workers); }
+    threads.push_back(cores);
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--determinism") == 0) { continue; }
+
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            std::cerr << "Error: Missing value for " << arg << "\n";
+            return false;
+        }
+
+        bool ok = true;
+        if (std::strcmp(arg, "--grid") == 0) { ok = std::sscanf(value, "%dx%d", &width, &height) == 2 && width > 0 && height > 0; }
+        else if (std::strcmp(arg, "--scenario") == 0) {
+            if (!parseNames(value, "scenario", Scenario::NAMES, Scenario::SCENARIO_COUNT, scenarios)) { return false; }
+        }
+        else if (std::strcmp(arg, "--engines") == 0) {
+            if (!parseNames(value, "engine", Simulation::ENGINE_NAMES, Simulation::ENGINE_COUNT, engines)) { return false; }
+        }
+        else if (std::strcmp(arg, "--threads") == 0) { ok = parseList(value, threads); }
+        else if (std::strcmp(arg, "--ticks") == 0) { ticks = std::max(1, std::atoi(value)); }
+        else if (std::strcmp(arg, "--seed") == 0) { seed = (unsigned int)std::strtoul(value, nullptr, 10); }
+        else { ok = false; }
+
+        if (!ok) {
+            std::cerr << "Error: Bad option " << arg << " " << value << "\n";
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+int runDeterminismCheck(int argc, char** argv)
+{
+    DeterminismOptions options;
+    if (!options.parse(argc, argv)) { return 1; }
+
+    PoolMap pools;
+    int failures = 0, runs = 0;
+    Clock::time_point start = Clock::now();
+    if (checkThreadCaches()) { std::printf("chunk allocator: every pool thread got a cache\n"); }
+    else {
+        std::printf("chunk allocator: FAILED, threads of later pools fell back to the shared lock\n");
+        failures++;
+    }
+
+    for (int scenario : options.scenarios) {
+        std::printf("%s, %dx%d, seed %u, %d ticks\n", Scenario::NAMES[scenario], options.width, options.height, options.seed, options.ticks);
+
+        // First run of each engine, the others of that engine must match it tick for tick
+        std::vector<uint64_t> references[Simulation::ENGINE_COUNT];
+        int referenceWorkers[Simulation::ENGINE_COUNT] = {};
+
+        for (int engineIndex : options.engines) {
+            Simulation::Engine engine = (Simulation::Engine)engineIndex;
+            std::vector<int> workerCounts = (engine == Simulation::ENGINE_STRIPED) ? options.threads : std::vector<int>(1, 1);
+
+            for (int workers : workerCounts) {
+                ThreadPool* pool = getPool(pools, engine, workers);
+                Simulation sim(options.width, options.height);
+                std::vector<uint64_t> hashes;
+                bool isReference = references[engine].empty();
+                int diverged = play(sim, engine, pool, scenario, options, options.ticks, isReference ? nullptr : &references[engine], hashes);
+                runs++;
+
+                char label[32];
+                std::snprintf(label, sizeof(label), "%s x%d", Simulation::ENGINE_NAMES[engine], workers);
+                if (!hashMatchesCells(sim)) {
+                    std::printf("  %-12s FAILED: the grid hash no longer matches its cells after %d ticks\n", label, (int)hashes.size());
+                    failures++;
+                }
+                else if (isReference) {
+                    references[engine] = hashes;
+                    referenceWorkers[engine] = workers;
+                    std::printf("  %-12s reference, final hash %016llx\n", label, (unsigned long long)hashes.back());
+                }
+                else if (diverged == 0) {
+                    std::printf("  %-12s OK\n", label);
+                }
+                else {
+                    Simulation reference(options.width, options.height);
+                    replay(reference, engine, getPool(pools, engine, referenceWorkers[engine]), scenario, options, diverged);
+                    std::printf("  %-12s DIVERGED from x%d at tick %d: %s\n", label, referenceWorkers[engine], diverged, describeDifference(reference, sim).c_str());
+                    failures++;
+                }
+                std::fflush(stdout);
+            }
+        }
+
+        // Engines may differ, the tick they part at is still worth knowing
+        const std::vector<uint64_t>& serial = references[Simulation::ENGINE_SERIAL];
+        const std::vector<uint64_t>& striped = references[Simulation::ENGINE_STRIPED];
+        if (serial.empty() || striped.empty() || serial.size() != striped.size()) { continue; }
+        size_t tick = 0;
+        while (tick < serial.size() && serial[tick] == striped[tick]) { ++tick; }
+        if (tick == serial.size()) {
+            std::printf("  striped matches serial on every tick\n");
+            continue;
+        }
+        Simulation serialGrid(options.width, options.height), stripedGrid(options.width, options.height);
+        replay(serialGrid, Simulation::ENGINE_SERIAL, nullptr, scenario, options, (int)tick + 1);
+        replay(stripedGrid, Simulation::ENGINE_STRIPED, getPool(pools, Simulation::ENGINE_STRIPED, referenceWorkers[Simulation::ENGINE_STRIPED]), scenario, options, (int)tick + 1);
+        std::printf("  note: striped parts from serial at tick %d (allowed at stripe borders): %s\n", (int)tick + 1,
+            describeDifference(serialGrid, stripedGrid).c_str());
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("%d runs in %.1f s, %d failed\n", runs, seconds, failures);
+    return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// `SandboxGL --determinism [options]`: proves the engines still compute the same ticks. Each
+// scenario is played from the same seed on every engine and worker count while the per-tick grid
+// hash (Simulation::getStateHash) is compared with the first run of that engine. The first tick
+// that differs is replayed on both sides and reported with the chunks that differ and the first
+// cell. Engines are compared with each other too, but as a note only, since the striped engine
+// is allowed to part from the serial one at stripe borders. Any difference within an engine, or a
+// grid hash that no longer matches its chunks, fails the run. Before the scenarios it checks that
+// the threads of pools made one after another all keep getting a chunk allocator cache.
+//   --grid WxH             grid size (default SIMULATION_GRID_WIDTH x HEIGHT)
+//   --scenario NAME[,NAME] scenarios to play (default all of them)
+//   --engines NAME[,NAME]  serial, striped or both (default both)
+//   --threads T[,T]        worker counts of the striped engine (default 1, 2, 4, ... up to every core, at least 4)
+//   --ticks N              ticks per run (default 600)
+//   --seed N               scenario seed (default 1)
+struct DeterminismOptions {
+	int width = 0;
+	int height = 0;
+	std::vector<int> scenarios;
+	std::vector<int> engines;
+	std::vector<int> threads;
+	int ticks = 600;
+	unsigned int seed = 1;
+
+	bool parse(int argc, char** argv);
+};
+
+int runDeterminismCheck(int argc, char** argv);
@@ -0,0 +1,55 @@
+#include "FrameArena.h"
+#include <cassert>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+
+FrameArena::FrameArena(size_t capacity)
+{
+    _buffer = new char[capacity];
+    _capacity = capacity;
+}
+
+FrameArena::~FrameArena()
+{
+    delete[] _buffer;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    uintptr_t base = reinterpret_cast<uintptr_t>(_buffer);
+    size_t start = ((base + _offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+
+    if (start + size > _capacity) {
+        assert(false && "FrameArena is out of space, raise FRAME_ARENA_SIZE");
+        return nullptr;
+    }
+
+    _offset = start + size;
+    if (_offset > _highWater) { _highWater = _offset; }
+    return _buffer + start;
+}
+
+const char* FrameArena::format(const char* fmt, ...)
+{
+    char* text = _buffer + _offset;
+    size_t available = _capacity - _offset;
+
+    va_list args;
+    va_start(args, fmt);
+    int length = std::vsnprintf(text, available, fmt, args);
+    va_end(args);
+
+    if (length < 0 || (size_t)length >= available) {
+        assert(false && "FrameArena is out of space, raise FRAME_ARENA_SIZE");
+        return "";
+    }
+
+    allocate(length + 1, 1);
+    return text;
+}
+
+void FrameArena::reset()
+{
+    _offset = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+// Linear allocator for per-frame temporaries (HUD text, scratch arrays).
+// Allocations are bumped out of one fixed block and all of them are released
+// together by reset() at the end of the frame.
+class FrameArena
+{
+public:
+	FrameArena(size_t capacity);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	const char* format(const char* fmt, ...);
+	void reset();
+
+	template <typename T>
+	T* allocateArray(size_t count) { return static_cast<T*>(allocate(sizeof(T) * count, alignof(T))); }
+
+	size_t getUsed() const { return _offset; }
+	size_t getCapacity() const { return _capacity; }
+	size_t getHighWater() const { return _highWater; }
+
+private:
+	char* _buffer;
+	size_t _capacity;
+	size_t _offset = 0;
+	size_t _highWater = 0;
+};
@@ -0,0 +1,292 @@
+#define _CRT_SECURE_NO_WARNINGS // fopen for the output stream
+#include "FrameCapture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include "Config.h"
+#include "ImageWriter.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace
+{
+    bool endsWith(const std::string& text, const char* suffix)
+    {
+        size_t length = std::strlen(suffix);
+        return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+    }
+
+    // Full range BT.601 (JPEG) in 16.16 fixed point, the stream header says XCOLORRANGE=FULL
+    unsigned char lumaOf(int r, int g, int b)
+    {
+        return (unsigned char)((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+    }
+
+    unsigned char chromaOf(int r, int g, int b, int kr, int kg, int kb)
+    {
+        return (unsigned char)std::min(255, (kr * r + kg * g + kb * b + (128 << 16) + 32768) >> 16);
+    }
+
+    // Appends the Y, Cb and Cr planes of a bottom-up RGBA frame, chroma averaged over 2x2 blocks
+    void appendYUV420(std::vector<unsigned char>& out, int width, int height, const uint32_t* pixels)
+    {
+        int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+        size_t lumaStart = out.size();
+        out.resize(lumaStart + (size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight);
+        unsigned char* luma = &out[lumaStart];
+        unsigned char* cb = luma + (size_t)width * height;
+        unsigned char* cr = cb + (size_t)chromaWidth * chromaHeight;
+
+        for (int y = 0; y < height; ++y) {
+            const unsigned char* source = (const unsigned char*)(pixels + (size_t)(height - 1 - y) * width);
+            for (int x = 0; x < width; ++x) {
+                luma[(size_t)y * width + x] = lumaOf(source[x * 4], source[x * 4 + 1], source[x * 4 + 2]);
+            }
+        }
+
+        for (int cy = 0; cy < chromaHeight; ++cy) {
+            int rows = std::min(2, height - cy * 2);
+            for (int cx = 0; cx < chromaWidth; ++cx) {
+                int columns = std::min(2, width - cx * 2);
+                int r = 0, g = 0, b = 0;
+                for (int dy = 0; dy < rows; ++dy) {
+                    const unsigned char* source = (const unsigned char*)(pixels + (size_t)(height - 1 - cy * 2 - dy) * width + cx * 2);
+                    for (int dx = 0; dx < columns; ++dx) {
+                        r += source[dx * 4];
+                        g += source[dx * 4 + 1];
+                        b += source[dx * 4 + 2];
+                    }
+                }
+                int count = rows * columns;
+                r = (r + count / 2) / count;
+                g = (g + count / 2) / count;
+                b = (b + count / 2) / count;
+                cb[(size_t)cy * chromaWidth + cx] = chromaOf(r, g, b, -11059, -21709, 32768);
+                cr[(size_t)cy * chromaWidth + cx] = chromaOf(r, g, b, 32768, -27439, -5329);
+            }
+        }
+    }
+}
+
+FrameCapture::FrameCapture(const char* path, int width, int height, int framesPerSecond)
+    : _writtenFrames(0), _failed(false)
+{
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_IO);
+
+    _width = width;
+    _height = height;
+    _framesPerSecond = framesPerSecond;
+    _path = path;
+    _toStdout = (_path == "-");
+    _y4m = _toStdout || endsWith(_path, ".y4m");
+
+    if (_y4m) {
+        if (_toStdout) {
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            _stream = stdout;
+        }
+        else {
+            _stream = fopen(path, "wb");
+        }
+        if (_stream == nullptr) {
+            std::cerr << "Error: Cannot open capture stream " << _path << "\n";
+            _failed = true;
+            return;
+        }
+        fprintf(_stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", width, height, framesPerSecond);
+    }
+
+    size_t frameBytes = (size_t)width * height * 4;
+    _readbacks.resize(std::max(2, CAPTURE_READBACK_BUFFERS));
+    for (Readback& readback : _readbacks) {
+        glGenBuffers(1, &readback.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    _open = true;
+    _encoder = std::thread(&FrameCapture::encoderLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    finish();
+}
+
+void FrameCapture::capture(int frameNumber)
+{
+    if (!_open || _finished) { return; }
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    // The slot about to be reused holds the oldest frame, which has to be through the encoder first
+    Readback& slot = _readbacks[_nextReadback];
+    if (getState(slot) == STATE_IN_FLIGHT) { map(slot, true); }
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (slot.state == STATE_ENCODING) {
+            _stalls++;
+            _changed.wait(lock, [&slot] { return slot.state == STATE_DONE; });
+        }
+    }
+    if (getState(slot) == STATE_DONE) { unmap(slot); }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frameNumber = frameNumber;
+    setState(slot, STATE_IN_FLIGHT);
+    _nextReadback = (_nextReadback + 1) % (int)_readbacks.size();
+    _capturedFrames++;
+
+    // Hand over whatever older readbacks the GPU has finished, oldest first to keep the order
+    bool blocked = false;
+    for (size_t i = 0; i + 1 < _readbacks.size(); ++i) {
+        Readback& readback = _readbacks[(_nextReadback + i) % _readbacks.size()];
+        State state = getState(readback);
+        if (state == STATE_DONE) { unmap(readback); }
+        else if (state == STATE_IN_FLIGHT && !blocked) {
+            if (isSignalled(readback.fence)) { map(readback, false); }
+            else { blocked = true; }
+        }
+    }
+
+    _captureMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void FrameCapture::finish()
+{
+    if (!_open || _finished) { return; }
+    _finished = true;
+
+    for (size_t i = 0; i < _readbacks.size(); ++i) {
+        Readback& readback = _readbacks[(_nextReadback + i) % _readbacks.size()];
+        if (getState(readback) == STATE_IN_FLIGHT) { map(readback, true); }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _changed.notify_all();
+    _encoder.join();
+
+    for (Readback& readback : _readbacks) {
+        if (readback.pixels != nullptr) { unmap(readback); }
+        glDeleteBuffers(1, &readback.buffer);
+    }
+    if (_stream != nullptr) {
+        if (_toStdout) { fflush(_stream); }
+        else { fclose(_stream); }
+        _stream = nullptr;
+    }
+}
+
+bool FrameCapture::isSignalled(GLsync fence)
+{
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+FrameCapture::State FrameCapture::getState(const Readback& readback)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return readback.state;
+}
+
+void FrameCapture::setState(Readback& readback, State state)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        readback.state = state;
+    }
+    _changed.notify_all();
+}
+
+void FrameCapture::map(Readback& readback, bool wait)
+{
+    if (wait && !isSignalled(readback.fence)) {
+        _stalls++;
+        GLenum status;
+        do {
+            status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    readback.pixels = (const uint32_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)_width * _height * 4, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (readback.pixels == nullptr) { _failed = true; }
+    setState(readback, STATE_ENCODING);
+}
+
+void FrameCapture::unmap(Readback& readback)
+{
+    if (readback.pixels != nullptr) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback.pixels = nullptr;
+    }
+    setState(readback, STATE_FREE);
+}
+
+void FrameCapture::encoderLoop()
+{
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_IO);
+    PROFILE_THREAD("capture encoder");
+
+    for (;;) {
+        Readback& readback = _readbacks[_nextEncode];
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _changed.wait(lock, [&] { return readback.state == STATE_ENCODING || _stopping; });
+            if (readback.state != STATE_ENCODING) { return; }
+        }
+
+        if (readback.pixels != nullptr) { encode(readback); }
+
+        setState(readback, STATE_DONE);
+        _nextEncode = (_nextEncode + 1) % (int)_readbacks.size();
+    }
+}
+
+void FrameCapture::encode(const Readback& readback)
+{
+    PROFILE_ZONE("encode");
+    if (_y4m) {
+        static const char frameHeader[] = "FRAME\n";
+        _encoded.assign(frameHeader, frameHeader + sizeof(frameHeader) - 1);
+        appendYUV420(_encoded, _width, _height, readback.pixels);
+        if (fwrite(_encoded.data(), 1, _encoded.size(), _stream) != _encoded.size()) {
+            _failed = true;
+            return;
+        }
+    }
+    else {
+        char path[1024];
+        std::snprintf(path, sizeof(path), "%s_%05d.png", _path.c_str(), readback.frameNumber);
+        ImageWriter::encodePNG(_width, _height, readback.pixels, true, _raw, _encoded);
+
+        FILE* file = fopen(path, "wb");
+        bool ok = (file != nullptr) && fwrite(_encoded.data(), 1, _encoded.size(), file) == _encoded.size();
+        if (file != nullptr) { ok = (fclose(file) == 0) && ok; }
+        if (!ok) {
+            _failed = true;
+            return;
+        }
+    }
+    _writtenFrames++;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records rendered frames without stalling the GL pipeline. capture() queues a glReadPixels
+// into one of a ring of pixel buffer objects followed by a fence; a frame or two later, once the
+// fence has signalled, the buffer is mapped and the encoder thread reads the pixels straight out
+// of the mapping. The encoder writes either a PNG sequence (PATH_00042.png) or, for a path
+// ending in ".y4m", one uncompressed YUV4MPEG2 4:2:0 stream. "-" streams Y4M to stdout, e.g. `SandboxGL ... | ffmpeg -i - out.mp4`.
+class FrameCapture
+{
+public:
+	FrameCapture(const char* path, int width, int height, int framesPerSecond = 60);
+	~FrameCapture();
+
+	bool isOpen() { return _open; }
+	bool isWritingToStdout() { return _toStdout; }
+
+	// Reads the bottom-left width x height pixels of the bound read framebuffer.
+	// frameNumber only names the PNG files.
+	void capture(int frameNumber);
+	// Waits for the outstanding readbacks and the encoder, then closes the output. Needs the GL context.
+	void finish();
+
+	int getCapturedFrames() { return _capturedFrames; }
+	int getWrittenFrames() { return _writtenFrames; }
+	int getStalls() { return _stalls; } // Times capture() had to wait for the GPU or the encoder
+	double getAverageCaptureMs() { return (_capturedFrames > 0) ? _captureMs / _capturedFrames : 0.0; }
+	bool hasFailed() { return _failed; }
+
+private:
+	// A readback moves FREE -> IN_FLIGHT -> ENCODING -> DONE -> FREE; mapping and unmapping
+	// stay on the GL thread, the encoder only reads the mapped pixels
+	enum State { STATE_FREE, STATE_IN_FLIGHT, STATE_ENCODING, STATE_DONE };
+
+	struct Readback
+	{
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+		const uint32_t* pixels = nullptr; // Mapped, bottom row first
+		int frameNumber = 0;
+		State state = STATE_FREE; // Guarded by _mutex
+	};
+
+	int _width, _height, _framesPerSecond;
+	std::string _path;
+	bool _y4m = false, _toStdout = false;
+	bool _open = false, _finished = false;
+	FILE* _stream = nullptr;
+
+	std::vector<Readback> _readbacks;
+	int _nextReadback = 0; // Render thread
+	int _nextEncode = 0; // Encoder thread
+	int _capturedFrames = 0;
+	int _stalls = 0;
+	double _captureMs = 0.0;
+
+	bool _stopping = false;
+	std::mutex _mutex;
+	std::condition_variable _changed;
+	std::thread _encoder;
+	std::atomic<int> _writtenFrames;
+	std::atomic<bool> _failed;
+
+	// Encoder thread only
+	std::vector<unsigned char> _raw, _encoded;
+
+	bool isSignalled(GLsync fence);
+	State getState(const Readback& readback);
+	void setState(Readback& readback, State state);
+	void map(Readback& readback, bool wait);
+	void unmap(Readback& readback);
+	void encoderLoop();
+	void encode(const Readback& readback);
+};
@@ -1,7 +1,6 @@
 #include "FrameCounter.h"
 
 void FrameCounter::update() {
-	static double previousSeconds = 0.0;
 	double currentSeconds = glfwGetTime(); // Returns number of seconds since GLFW started, as a double float
 	double elapsedSeconds = currentSeconds - previousSeconds;
 	
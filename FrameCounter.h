@@ -10,5 +10,8 @@ public:
 
 	int currentFrame = 0;
 	double FPS = -1;
+
+private:
+	double previousSeconds = 0.0; // Start of the current one second window
 };
 
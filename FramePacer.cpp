@@ -0,0 +1,58 @@
+#include "FramePacer.h"
+#include <cmath>
+#include <thread>
+
+FramePacer::FramePacer(double framesPerSecond)
+{
+    setRate(framesPerSecond);
+}
+
+void FramePacer::setRate(double framesPerSecond)
+{
+    _framesPerSecond = framesPerSecond;
+    _interval = (framesPerSecond > 0.0)
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond))
+        : Clock::duration::zero();
+    _started = false;
+}
+
+void FramePacer::wait()
+{
+    if (_framesPerSecond <= 0.0) { return; }
+
+    Clock::time_point now = Clock::now();
+    if (!_started) {
+        _started = true;
+        _nextFrame = now + _interval;
+        return;
+    }
+
+    sleepUntil(_nextFrame);
+
+    // A frame that ran long starts the schedule over instead of bursting to catch up
+    _nextFrame += _interval;
+    now = Clock::now();
+    if (_nextFrame < now) { _nextFrame = now + _interval; }
+}
+
+void FramePacer::sleepUntil(Clock::time_point target)
+{
+    for (;;) {
+        double remaining = std::chrono::duration<double>(target - Clock::now()).count();
+        double estimate = _sleepMean + std::sqrt(_sleepM2 / _sleepCount);
+        if (remaining <= estimate) { break; }
+
+        Clock::time_point start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double observed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        _sleepCount++;
+        double delta = observed - _sleepMean;
+        _sleepMean += delta / _sleepCount;
+        _sleepM2 += delta * (observed - _sleepMean);
+    }
+
+    while (Clock::now() < target) {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+
+// Holds frames to a fixed rate. OS sleeps overshoot by up to a scheduler tick, so the pacer
+// sleeps in 1 ms steps only while the remaining time exceeds its running estimate of how long
+// such a sleep really takes (mean plus one standard deviation), then spins the rest.
+class FramePacer
+{
+public:
+	FramePacer(double framesPerSecond = 0.0); // 0 never waits
+
+	void setRate(double framesPerSecond);
+	double getRate() { return _framesPerSecond; }
+
+	// Blocks until one frame interval after the previous wait returned
+	void wait();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	double _framesPerSecond = 0.0;
+	Clock::duration _interval;
+	Clock::time_point _nextFrame;
+	bool _started = false;
+
+	// Observed length of a 1 ms sleep in seconds, Welford running mean/variance
+	double _sleepMean = 0.002, _sleepM2 = 0.0;
+	long long _sleepCount = 1;
+
+	void sleepUntil(Clock::time_point target);
+};
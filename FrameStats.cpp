@@ -0,0 +1,169 @@
+#define _CRT_SECURE_NO_WARNINGS // fopen for the report
+#include "FrameStats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "CommandLine.h"
+#include "Config.h"
+#include "Scenario.h"
+
+const char* const FrameStats::PHASE_NAMES[PHASE_COUNT] = {
+    "input", "simulation", "upload", "draw", "capture", "gui", "present", "pacing", "frame"
+};
+
+namespace
+{
+    const uint64_t MAX_NANOSECONDS = (1ull << 36) - 1;
+
+    int bucketOf(uint64_t nanoseconds)
+    {
+        if (nanoseconds < 2 * TimeHistogram::SUB_BUCKETS) { return (int)nanoseconds; }
+        int log2 = 0;
+        while ((nanoseconds >> (log2 + 1)) != 0) { ++log2; }
+        int shift = log2 - 6; // Leaves the top 7 bits, 64..127
+        return TimeHistogram::SUB_BUCKETS * shift + (int)(nanoseconds >> shift);
+    }
+
+    // Middle of the bucket's range
+    double bucketValue(int bucket)
+    {
+        if (bucket < 2 * TimeHistogram::SUB_BUCKETS) { return bucket; }
+        int shift = bucket / TimeHistogram::SUB_BUCKETS - 1;
+        uint64_t low = (uint64_t)(bucket - TimeHistogram::SUB_BUCKETS * shift) << shift;
+        return (double)low + (double)(1ull << shift) * 0.5;
+    }
+}
+
+void TimeHistogram::record(double milliseconds)
+{
+    uint64_t nanoseconds = (uint64_t)std::min(std::max(milliseconds * 1e6, 0.0), (double)MAX_NANOSECONDS);
+    _buckets[bucketOf(nanoseconds)]++;
+    _count++;
+    _totalMs += milliseconds;
+    _maxMs = std::max(_maxMs, milliseconds);
+}
+
+void TimeHistogram::reset()
+{
+    std::memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _totalMs = 0.0;
+    _maxMs = 0.0;
+}
+
+double TimeHistogram::getPercentile(double percentile)
+{
+    if (_count == 0) { return 0.0; }
+    uint64_t rank = (uint64_t)std::ceil(percentile / 100.0 * _count);
+    rank = std::max<uint64_t>(rank, 1);
+    if (rank >= (uint64_t)_count) { return _maxMs; }
+
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += _buckets[bucket];
+        if (seen >= rank) { return std::min(bucketValue(bucket) / 1e6, _maxMs); }
+    }
+    return _maxMs;
+}
+
+bool BenchmarkOptions::parse(int argc, char** argv)
+{
+    reportPath = BENCHMARK_REPORT_PATH;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--benchmark") == 0) { enabled = true; continue; }
+
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            std::cerr << "Error: Missing value for " << arg << "\n";
+            return false;
+        }
+
+        if (std::strcmp(arg, "--frames") == 0) { frames = std::atoi(value); }
+        else if (std::strcmp(arg, "--fps-cap") == 0) { fpsCap = std::atof(value); }
+        else if (std::strcmp(arg, "--report") == 0) { reportPath = value; }
+        else if (std::strcmp(arg, "--seed") == 0) { seed = (unsigned int)std::strtoul(value, nullptr, 10); }
+        else if (std::strcmp(arg, "--scenario") == 0) {
+            if (!parseName(value, "scenario", Scenario::NAMES, Scenario::SCENARIO_COUNT, scenario)) { return false; }
+        }
+        else {
+            std::cerr << "Error: Bad option " << arg << " " << value << "\n";
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+void FrameStats::beginFrame()
+{
+    _frameStart = Clock::now();
+    _lastMark = _frameStart;
+    if (!_running) {
+        _running = true;
+        _runStart = _frameStart;
+    }
+}
+
+void FrameStats::mark(Phase phase)
+{
+    Clock::time_point now = Clock::now();
+    _histograms[phase].record(std::chrono::duration<double, std::milli>(now - _lastMark).count());
+    _lastMark = now;
+}
+
+void FrameStats::endFrame()
+{
+    _histograms[PHASE_FRAME].record(std::chrono::duration<double, std::milli>(Clock::now() - _frameStart).count());
+}
+
+void FrameStats::reset()
+{
+    for (TimeHistogram& histogram : _histograms) { histogram.reset(); }
+    _running = false;
+}
+
+bool FrameStats::writeReport(const char* path, const BenchmarkOptions& options, const char* rendererName)
+{
+    FILE* file = std::fopen(path, "w");
+    if (file == nullptr) { return false; }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - _runStart).count();
+    int frames = getFrameCount();
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"frames\": %d,\n", frames);
+    std::fprintf(file, "  \"seconds\": %.3f,\n", seconds);
+    std::fprintf(file, "  \"averageFps\": %.2f,\n", (seconds > 0.0) ? frames / seconds : 0.0);
+    std::fprintf(file, "  \"fpsCap\": %.2f,\n", options.fpsCap);
+    std::fprintf(file, "  \"seed\": %u,\n", options.seed);
+    std::fprintf(file, "  \"scenario\": \"%s\",\n", (options.scenario >= 0) ? Scenario::NAMES[options.scenario] : "falling grains");
+    std::fprintf(file, "  \"renderer\": \"%s\",\n", rendererName);
+    std::fprintf(file, "  \"phasesMs\": {\n");
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        TimeHistogram& histogram = _histograms[phase];
+        std::fprintf(file, "    \"%s\": { \"count\": %d, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+            PHASE_NAMES[phase], histogram.getCount(), histogram.getMean(), histogram.getPercentile(50.0),
+            histogram.getPercentile(95.0), histogram.getPercentile(99.0), histogram.getMax(),
+            (phase + 1 < PHASE_COUNT) ? "," : "");
+    }
+    std::fprintf(file, "  }\n");
+    std::fprintf(file, "}\n");
+
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+    return ok;
+}
+
+void FrameStats::printSummary()
+{
+    std::printf("%-12s %9s %9s %9s %9s %9s\n", "phase (ms)", "mean", "p50", "p95", "p99", "max");
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        TimeHistogram& histogram = _histograms[phase];
+        std::printf("%-12s %9.3f %9.3f %9.3f %9.3f %9.3f\n", PHASE_NAMES[phase], histogram.getMean(),
+            histogram.getPercentile(50.0), histogram.getPercentile(95.0), histogram.getPercentile(99.0), histogram.getMax());
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Log-linear histogram of durations in nanoseconds: exact below 128 ns, then 64 buckets per
+// power of two, so any percentile is within ~1.6% of the recorded value and recording is O(1).
+class TimeHistogram
+{
+public:
+	static const int SUB_BUCKETS = 64;
+	static const int BUCKET_COUNT = SUB_BUCKETS * 31; // Up to 2^36 ns, about a minute
+
+	void record(double milliseconds);
+	void reset();
+
+	int getCount() { return _count; }
+	double getMean() { return (_count > 0) ? _totalMs / _count : 0.0; }
+	double getMax() { return _maxMs; }
+	double getPercentile(double percentile); // 0-100, in milliseconds
+
+private:
+	uint32_t _buckets[BUCKET_COUNT] = {};
+	int _count = 0;
+	double _totalMs = 0.0;
+	double _maxMs = 0.0;
+};
+
+// `SandboxGL --benchmark [options]`: the interactive window with vsync off, seeded grains
+// raining in like --headless, frame-time percentiles printed and written as JSON at exit.
+//   --frames N      frames to run after the warmup, 0 runs until the window closes (default 0)
+//   --fps-cap F     pace frames to F per second with FramePacer, 0 for uncapped (default 0)
+//   --report PATH   JSON report (default BENCHMARK_REPORT_PATH)
+//   --seed S        seed of the falling grains or of the scenario (default 1)
+//   --scenario NAME load a Scenario at the start instead of the falling grains
+struct BenchmarkOptions {
+	bool enabled = false;
+	int frames = 0;
+	double fpsCap = 0.0;
+	std::string reportPath;
+	unsigned int seed = 1;
+	int scenario = -1; // Scenario::Id
+
+	bool parse(int argc, char** argv);
+};
+
+// Per-phase CPU time of the window loop. mark() charges the time since the previous mark (or
+// beginFrame) to a phase, so the marks follow the loop in order and nothing is timed twice.
+class FrameStats
+{
+public:
+	enum Phase {
+		PHASE_INPUT = 0,
+		PHASE_SIMULATION,
+		PHASE_UPLOAD,
+		PHASE_DRAW,
+		PHASE_CAPTURE,
+		PHASE_GUI,
+		PHASE_PRESENT,
+		PHASE_PACING,
+		PHASE_FRAME, // Whole frame, beginFrame to endFrame
+		PHASE_COUNT
+	};
+	static const char* const PHASE_NAMES[PHASE_COUNT];
+
+	void beginFrame();
+	void mark(Phase phase);
+	void endFrame();
+	void reset();
+
+	TimeHistogram& getHistogram(Phase phase) { return _histograms[phase]; }
+	int getFrameCount() { return _histograms[PHASE_FRAME].getCount(); }
+
+	bool writeReport(const char* path, const BenchmarkOptions& options, const char* rendererName);
+	void printSummary();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	TimeHistogram _histograms[PHASE_COUNT];
+	Clock::time_point _frameStart, _lastMark;
+	Clock::time_point _runStart;
+	bool _running = false;
+};
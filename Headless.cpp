@@ -0,0 +1,184 @@
+#include "Headless.h"
+#include "CommandLine.h"
+#include "Config.h"
+#include "Simulation.h"
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
+#include "ImageWriter.h"
+#include "Profiler.h"
+#include "PerfCounters.h"
+#include "Scenario.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    bool parseSize(const char* text, int& width, int& height)
+    {
+        return std::sscanf(text, "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+    }
+}
+
+bool HeadlessOptions::parse(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        // Flags without a value
+        if (std::strcmp(arg, "--headless") == 0 || std::strcmp(arg, "--offscreen") == 0) { continue; }
+        if (std::strcmp(arg, "--surfaceless") == 0) { surfaceless = true; continue; }
+        if (std::strcmp(arg, "--perf") == 0) { perfCounters = true; continue; }
+
+        if (value == nullptr) {
+            std::cerr << "Error: Missing value for " << arg << "\n";
+            return false;
+        }
+
+        bool ok = true;
+        if (std::strcmp(arg, "--frames") == 0) { frames = std::atoi(value); }
+        else if (std::strcmp(arg, "--grid") == 0) { ok = parseSize(value, gridWidth, gridHeight); }
+        else if (std::strcmp(arg, "--size") == 0) { ok = parseSize(value, imageWidth, imageHeight); }
+        else if (std::strcmp(arg, "--dump-every") == 0) { dumpEvery = std::atoi(value); }
+        else if (std::strcmp(arg, "--out") == 0) { outPrefix = value; }
+        else if (std::strcmp(arg, "--seed") == 0) { seed = (unsigned int)std::strtoul(value, nullptr, 10); }
+        else if (std::strcmp(arg, "--scenario") == 0) {
+            if (!parseName(value, "scenario", Scenario::NAMES, Scenario::SCENARIO_COUNT, scenario)) { return false; }
+        }
+        else if (std::strcmp(arg, "--engine") == 0) {
+            if (!parseName(value, "engine", Simulation::ENGINE_NAMES, Simulation::ENGINE_COUNT, engine)) { return false; }
+        }
+        else if (std::strcmp(arg, "--threads") == 0) { threads = std::atoi(value); }
+        else if (std::strcmp(arg, "--mode") == 0) { mode = std::atoi(value); }
+        else if (std::strcmp(arg, "--trace") == 0) { tracePath = value; }
+        else if (std::strcmp(arg, "--trace-frames") == 0) {
+            traceLast = 0;
+            ok = std::sscanf(value, "%d-%d", &traceFirst, &traceLast) >= 1 && traceFirst > 0;
+        }
+        else { ok = false; }
+
+        if (!ok) {
+            std::cerr << "Error: Bad option " << arg << " " << value << "\n";
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+std::string HeadlessOptions::getFramePath(int tick)
+{
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_%05d.png", tick);
+    return outPrefix + suffix;
+}
+
+bool HeadlessOptions::startTraceAt(int tick)
+{
+    if (tracePath.empty() || tick != traceFirst) { return true; }
+
+    int tracedFrames = (traceLast >= traceFirst) ? traceLast - traceFirst + 1 : 0;
+    if (Profiler::startTrace(tracePath.c_str(), tracedFrames)) { return true; }
+    std::cerr << "Error: Cannot write the trace to " << tracePath
+        << (Profiler::isEnabled() ? "" : ", define SANDBOX_PROFILE to profile release builds") << "\n";
+    return false;
+}
+
+void printPerfCounters(FILE* report, PerfCounters& perf)
+{
+    if (!perf.isAvailable()) {
+        std::fprintf(report, "Perf: hardware counters unavailable (no PMU access, or not Linux)\n");
+        return;
+    }
+
+    const PerfCounters::Totals& totals = perf.getTotals();
+    char summary[256];
+    perf.format(totals, summary, sizeof(summary));
+    std::fprintf(report, "Perf: %s over %d ticks\n", summary, totals.samples);
+    for (int counter = 0; counter < PerfCounters::COUNTER_COUNT; ++counter) {
+        if (!perf.isValid((PerfCounters::Counter)counter)) { continue; }
+        std::fprintf(report, "  %-14s %14.0f per tick\n", PerfCounters::COUNTER_NAMES[counter], totals.getPerSample((PerfCounters::Counter)counter));
+    }
+}
+
+bool reportScenario(FILE* report, Scenario& scenario, Simulation& sim)
+{
+    std::string failure;
+    bool ok = scenario.check(sim, failure);
+    std::fprintf(report, "Scenario: %s after %u ticks, %s%s\n", scenario.getName(), sim.getTickCount(),
+        ok ? (sim.isSettled() ? "settled, " : "") : "FAILED: ", ok ? "OK" : failure.c_str());
+    return ok;
+}
+
+void spawnHeadlessGrains(Simulation& sim, std::mt19937& rng, int tick, int frames)
+{
+    if (tick >= frames / 2) { return; }
+
+    int grains = sim.getWidth() / 2;
+    for (int i = 0; i < grains; ++i) {
+        int x = (int)(rng() % (unsigned int)sim.getWidth());
+        int y = (int)(rng() % (unsigned int)std::max(1, sim.getHeight() / 8));
+        sim.setTile(x, y, (rng() & 1) ? Simulation::TILE_SAND : Simulation::TILE_WATER);
+    }
+}
+
+int runHeadless(int argc, char** argv)
+{
+    HeadlessOptions options;
+    if (!options.parse(argc, argv)) { return 1; }
+
+    Simulation sim(options.gridWidth, options.gridHeight);
+    ThreadPool pool(options.threads);
+    SoftwareRenderer renderer(&sim, &pool, options.imageWidth, options.imageHeight);
+    std::mt19937 rng(options.seed);
+    Scenario scenario((options.scenario >= 0) ? (Scenario::Id)options.scenario : Scenario::SCENARIO_RAIN, options.seed);
+    if (options.scenario >= 0) { scenario.setUp(sim); }
+    sim.setEngine((Simulation::Engine)options.engine, &pool);
+    PerfCounters perf;
+    if (options.perfCounters) {
+        if (options.engine == Simulation::ENGINE_STRIPED) { perf.addThreads(pool); }
+        sim.setPerfCounters(&perf);
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    double simulationMs = 0.0, renderMs = 0.0;
+    int rendered = 0;
+
+    for (int tick = 1; tick <= options.frames; ++tick) {
+        if (!options.startTraceAt(tick)) { return 1; }
+        Profiler::beginFrame();
+
+        Clock::time_point start = Clock::now();
+        if (options.scenario >= 0) { scenario.update(sim); }
+        else { spawnHeadlessGrains(sim, rng, tick, options.frames); }
+        sim.step();
+        simulationMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        if (options.isDumpTick(tick)) {
+            PROFILE_ZONE("software render");
+            start = Clock::now();
+            renderer.render();
+            renderMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            rendered++;
+
+            std::string path = options.getFramePath(tick);
+            if (!ImageWriter::writePNG(path.c_str(), renderer.getWidth(), renderer.getHeight(), renderer.getPixels())) {
+                std::cerr << "Error: Cannot write " << path << "\n";
+                return 1;
+            }
+        }
+        Profiler::endFrame();
+    }
+    Profiler::stopTrace();
+
+    std::printf("Headless: %d ticks on %dx%d (%s), %.3f ms/tick, %d frames at %dx%d, %.3f ms/frame on %d threads\n",
+        options.frames, options.gridWidth, options.gridHeight, Simulation::ENGINE_NAMES[options.engine], simulationMs / std::max(1, options.frames),
+        rendered, options.imageWidth, options.imageHeight, renderMs / std::max(1, rendered), pool.getThreadCount());
+    if (options.perfCounters) { printPerfCounters(stdout, perf); }
+    if (options.scenario >= 0 && !reportScenario(stdout, scenario, sim)) { return 1; }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include "Config.h"
+#include "Simulation.h"
+
+// Options shared by the windowless runners:
+//   --frames N        simulation ticks to run (default 600)
+//   --grid WxH        simulation grid size (default SIMULATION_GRID_WIDTH x HEIGHT)
+//   --size WxH        output image size (default WINDOW_WIDTH x WINDOW_HEIGHT)
+//   --dump-every K    write every K-th tick, 0 writes only the last one (default 0)
+//   --out PREFIX      image path prefix, PREFIX_00042.png (default "frame"); --offscreen also
+//                     takes NAME.y4m or "-" for a Y4M stream of the dumped frames
+//   --seed S          seed of the falling grains or of the scenario (default 1)
+//   --scenario NAME   a Scenario instead of the falling grains, checked against its expected
+//                     steady state at the end (a failed check fails the run)
+//   --engine NAME     simulation engine, serial or striped (default serial)
+//   --threads T       software render threads and striped engine workers, 0 for one per hardware
+//                     thread (default 0)
+//   --mode M          GL render mode for --offscreen (default Renderer's default)
+//   --surfaceless     --offscreen without any window system (GLFW null platform + EGL)
+//   --perf            hardware counters of the simulation ticks (Linux perf_event_open), the
+//                     striped engine's workers included
+//   --trace PATH      Chrome trace JSON of the profiler zones (needs a debug build or SANDBOX_PROFILE defined)
+//   --trace-frames A-B  ticks the trace covers, A alone traces from A to the end (default all)
+struct HeadlessOptions {
+	int frames = 600;
+	int gridWidth = SIMULATION_GRID_WIDTH, gridHeight = SIMULATION_GRID_HEIGHT;
+	int imageWidth = WINDOW_WIDTH, imageHeight = WINDOW_HEIGHT;
+	int dumpEvery = 0;
+	std::string outPrefix = "frame";
+	unsigned int seed = 1;
+	int scenario = -1; // Scenario::Id, -1 for spawnHeadlessGrains
+	int engine = Simulation::ENGINE_SERIAL;
+	int threads = 0;
+	int mode = -1;
+	bool surfaceless = false;
+	bool perfCounters = false;
+	std::string tracePath;
+	int traceFirst = 1, traceLast = 0;
+
+	bool parse(int argc, char** argv);
+	bool isDumpTick(int tick) { return (dumpEvery > 0) ? (tick % dumpEvery == 0) : (tick == frames); }
+	std::string getFramePath(int tick);
+	bool startTraceAt(int tick); // Opens the trace on its first tick, false if it can't be written
+};
+
+class PerfCounters;
+class Scenario;
+
+// Perf: line of the runners' report, totals since the counters were reset
+void printPerfCounters(FILE* report, PerfCounters& perf);
+
+// Scenario: line of the runners' report, false if the grid failed the scenario's check
+bool reportScenario(FILE* report, Scenario& scenario, Simulation& sim);
+
+// Deterministic stand-in for the brush: grains rain onto the top rows for the first half of the run
+void spawnHeadlessGrains(Simulation& sim, std::mt19937& rng, int tick, int frames);
+
+// `SandboxGL --headless [options]`: simulation without a window or GL context,
+// frames are drawn by the SoftwareRenderer and written as PNG files.
+int runHeadless(int argc, char** argv);
@@ -0,0 +1,154 @@
+#define _CRT_SECURE_NO_WARNINGS // Plain fopen/fprintf
+#include "ImageWriter.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "MemoryTracker.h"
+
+namespace
+{
+    uint32_t crcTable[256];
+
+    uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size)
+    {
+        if (crcTable[1] == 0) {
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) { c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1; }
+                crcTable[n] = c;
+            }
+        }
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i) { crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8); }
+        return ~crc;
+    }
+
+    void putBigEndian(std::vector<unsigned char>& out, uint32_t value)
+    {
+        out.push_back((unsigned char)(value >> 24));
+        out.push_back((unsigned char)(value >> 16));
+        out.push_back((unsigned char)(value >> 8));
+        out.push_back((unsigned char)value);
+    }
+
+    // Appends length, type, data and CRC of one PNG chunk
+    void appendChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size)
+    {
+        putBigEndian(out, (uint32_t)size);
+        size_t typeStart = out.size();
+        out.insert(out.end(), type, type + 4);
+        if (size > 0) { out.insert(out.end(), data, data + size); }
+        putBigEndian(out, crc32(0, &out[typeStart], size + 4));
+    }
+}
+
+bool ImageWriter::writePNG(const char* path, int width, int height, const uint32_t* pixels)
+{
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_IO);
+
+    std::vector<unsigned char> raw, png;
+    encodePNG(width, height, pixels, false, raw, png);
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) { return false; }
+    fwrite(png.data(), 1, png.size(), file);
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+void ImageWriter::encodePNG(int width, int height, const uint32_t* pixels, bool bottomUp,
+    std::vector<unsigned char>& raw, std::vector<unsigned char>& out)
+{
+    out.clear();
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.insert(out.end(), signature, signature + sizeof(signature));
+
+    unsigned char header[13] = {
+        (unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+        (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+        8, // Bit depth
+        2, // RGB
+        0, 0, 0
+    };
+    appendChunk(out, "IHDR", header, sizeof(header));
+
+    // Filter byte 0 per row, then RGB
+    size_t rowBytes = (size_t)width * 3 + 1;
+    raw.resize(rowBytes * height);
+    for (int y = 0; y < height; ++y) {
+        unsigned char* row = &raw[y * rowBytes];
+        row[0] = 0;
+        int sourceRow = bottomUp ? height - 1 - y : y;
+        const unsigned char* source = (const unsigned char*)(pixels + (size_t)sourceRow * width);
+        for (int x = 0; x < width; ++x) {
+            row[1 + x * 3] = source[x * 4];
+            row[2 + x * 3] = source[x * 4 + 1];
+            row[3 + x * 3] = source[x * 4 + 2];
+        }
+    }
+
+    // zlib stream made of stored blocks of at most 65535 bytes, built in place inside an IDAT chunk
+    out.reserve(out.size() + raw.size() + raw.size() / 65535 * 5 + 64);
+    size_t chunkStart = out.size();
+    putBigEndian(out, 0); // Length, patched below
+    out.insert(out.end(), { 'I', 'D', 'A', 'T' });
+    out.push_back(0x78);
+    out.push_back(0x01);
+    uint32_t adlerA = 1, adlerB = 0;
+    for (size_t offset = 0; offset < raw.size() || offset == 0; ) {
+        size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = (offset + blockSize == raw.size());
+        out.push_back(last ? 1 : 0);
+        out.push_back((unsigned char)blockSize);
+        out.push_back((unsigned char)(blockSize >> 8));
+        out.push_back((unsigned char)~blockSize);
+        out.push_back((unsigned char)(~blockSize >> 8));
+        out.insert(out.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+
+        // 5552 bytes is the most the sums take before they could overflow 32 bits
+        for (size_t i = offset; i < offset + blockSize; ) {
+            size_t end = std::min(offset + blockSize, i + 5552);
+            for (; i < end; ++i) {
+                adlerA += raw[i];
+                adlerB += adlerA;
+            }
+            adlerA %= 65521;
+            adlerB %= 65521;
+        }
+        offset += blockSize;
+        if (last) { break; }
+    }
+    putBigEndian(out, (adlerB << 16) | adlerA);
+
+    uint32_t dataSize = (uint32_t)(out.size() - chunkStart - 8);
+    for (int i = 0; i < 4; ++i) { out[chunkStart + i] = (unsigned char)(dataSize >> (24 - 8 * i)); }
+    putBigEndian(out, crc32(0, &out[chunkStart + 4], dataSize + 4));
+
+    appendChunk(out, "IEND", nullptr, 0);
+}
+
+bool ImageWriter::writePPM(const char* path, int width, int height, const uint32_t* pixels)
+{
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_IO);
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) { return false; }
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row((size_t)width * 3);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* source = (const unsigned char*)(pixels + (size_t)y * width);
+        for (int x = 0; x < width; ++x) {
+            row[x * 3] = source[x * 4];
+            row[x * 3 + 1] = source[x * 4 + 1];
+            row[x * 3 + 2] = source[x * 4 + 2];
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Minimal image output for headless runs and captures, no external dependencies.
+// Pixels are RGBA8, top row first, four bytes per pixel in memory order.
+class ImageWriter
+{
+public:
+	// 8-bit RGB PNG, deflate "stored" blocks only: fast to write, larger than a compressed PNG
+	static bool writePNG(const char* path, int width, int height, const uint32_t* pixels);
+	// Same file in memory. raw and out are scratch the caller can reuse to stay allocation free,
+	// bottomUp takes the rows in glReadPixels order.
+	static void encodePNG(int width, int height, const uint32_t* pixels, bool bottomUp,
+		std::vector<unsigned char>& raw, std::vector<unsigned char>& out);
+	static bool writePPM(const char* path, int width, int height, const uint32_t* pixels);
+};
@@ -1,20 +1,49 @@
+#include <glad/glad.h> // LatencyTracker.h needs it ahead of the GLFW header InputManager.h includes
 #include "InputManager.h"
+#include "LatencyTracker.h"
 #include "Config.h"
 #include <iostream>
 #include <random>
+#include <cmath>
 
 GLenum currentPolygonMode = GL_FILL;
 std::default_random_engine rng(std::random_device{}());
 std::uniform_real_distribution<float> dist(0.0f, 1.0f);
 
-InputManager::InputManager(GLFWwindow* window, Simulation* sim)
+InputManager::InputManager(GLFWwindow* window, Simulation* sim, Camera* camera)
 {
     this->_window = window;
     this->_sim = sim;
+    this->_camera = camera;
     glfwSetWindowUserPointer(window, this);
 	glfwSetKeyCallback(window, [](GLFWwindow* w, int key, int scancode, int action, int mods) {
         static_cast<InputManager*>(glfwGetWindowUserPointer(w))->key_callback(w, key, scancode, action, mods);
 		});
+	glfwSetScrollCallback(window, [](GLFWwindow* w, double xOffset, double yOffset) {
+        static_cast<InputManager*>(glfwGetWindowUserPointer(w))->scroll_callback(w, xOffset, yOffset);
+		});
+
+    // Anything that can change what the window shows wakes an idle main loop. ImGui chains
+    // to the cursor, button and focus callbacks when it installs its own.
+	glfwSetCursorPosCallback(window, [](GLFWwindow* w, double x, double y) {
+        InputManager* input = static_cast<InputManager*>(glfwGetWindowUserPointer(w));
+        input->_activity = true;
+        if (input->_latency != nullptr && input->isMousePressed(GLFW_MOUSE_BUTTON_1)) { input->_latency->onInput(); } // Brush drag
+		});
+	glfwSetMouseButtonCallback(window, [](GLFWwindow* w, int button, int action, int mods) {
+        InputManager* input = static_cast<InputManager*>(glfwGetWindowUserPointer(w));
+        input->_activity = true;
+        if (input->_latency != nullptr && button == GLFW_MOUSE_BUTTON_1 && action == GLFW_PRESS) { input->_latency->onInput(); }
+		});
+	glfwSetWindowFocusCallback(window, [](GLFWwindow* w, int focused) {
+        static_cast<InputManager*>(glfwGetWindowUserPointer(w))->_activity = true;
+		});
+	glfwSetWindowRefreshCallback(window, [](GLFWwindow* w) {
+        static_cast<InputManager*>(glfwGetWindowUserPointer(w))->_activity = true;
+		});
+	glfwSetFramebufferSizeCallback(window, [](GLFWwindow* w, int width, int height) {
+        static_cast<InputManager*>(glfwGetWindowUserPointer(w))->_activity = true;
+		});
 }
 
 bool InputManager::isKeyPressed(int key)
@@ -39,8 +68,17 @@ void InputManager::toggleWireframe(bool _isEnabled)
     }
 }
 
+bool InputManager::consumeActivity()
+{
+    bool activity = _activity;
+    _activity = false;
+    return activity;
+}
+
 void InputManager::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+    _activity = true;
+
     /*TOGGLE WIREFRAME*/
 
     if (key == TOGGLE_POLYGON_KEY)
@@ -66,32 +104,122 @@ void InputManager::key_callback(GLFWwindow* window, int key, int scancode, int a
     {
         selectedType = Simulation::TILE_WATER;
     }
+    if (isKeyPressed(GLFW_KEY_3))
+    {
+        selectedType = Simulation::TILE_STONE;
+    }
+
+    /*CAMERA*/
+
+    if (key == CAMERA_RESET_KEY && action == GLFW_PRESS)
+    {
+        _camera->reset();
+    }
+
+    /*CAPTURE*/
+
+    if (key == CAPTURE_KEY && action == GLFW_PRESS)
+    {
+        recording = !recording;
+    }
+
+    if (key == TRACE_KEY && action == GLFW_PRESS)
+    {
+        traceRequested = true;
+    }
+}
+
+void InputManager::scroll_callback(GLFWwindow* window, double xOffset, double yOffset)
+{
+    _pendingScroll += yOffset;
+    _activity = true;
+}
+
+void InputManager::updateCamera(GLFWwindow* window)
+{
+    int windowWidth, windowHeight;
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    if (windowWidth <= 0 || windowHeight <= 0) { return; }
+
+    double cursorX, cursorY;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+
+    // Zoom around the cursor
+    if (_pendingScroll != 0.0)
+    {
+        glm::vec2 cursorWorld = _camera->screenToWorld(cursorX, cursorY, windowWidth, windowHeight);
+        _camera->zoomAt(cursorWorld, (float)std::pow(CAMERA_ZOOM_STEP, _pendingScroll));
+        _pendingScroll = 0.0;
+    }
+
+    // Drag with the right button, the grabbed point follows the cursor
+    if (isMousePressed(GLFW_MOUSE_BUTTON_2))
+    {
+        if (_panning)
+        {
+            glm::vec2 from = _camera->screenToWorld(_panCursorX, _panCursorY, windowWidth, windowHeight);
+            glm::vec2 to = _camera->screenToWorld(cursorX, cursorY, windowWidth, windowHeight);
+            _camera->pan(from - to);
+        }
+        _panning = true;
+        _activity = true;
+        _panCursorX = cursorX;
+        _panCursorY = cursorY;
+    }
+    else
+    {
+        _panning = false;
+    }
+
+    glm::vec2 keyPan(0.0f);
+    if (isKeyPressed(GLFW_KEY_LEFT)) { keyPan.x -= 1.0f; }
+    if (isKeyPressed(GLFW_KEY_RIGHT)) { keyPan.x += 1.0f; }
+    if (isKeyPressed(GLFW_KEY_DOWN)) { keyPan.y -= 1.0f; }
+    if (isKeyPressed(GLFW_KEY_UP)) { keyPan.y += 1.0f; }
+    if (keyPan != glm::vec2(0.0f))
+    {
+        // The screen is 2 / zoom world units wide
+        _camera->pan(keyPan * (CAMERA_PAN_STEP * 2.0f / _camera->getZoom()));
+        _activity = true;
+    }
 }
 
 void InputManager::processInput(GLFWwindow* window)
 {
+    updateCamera(window);
+
     if (isMousePressed(GLFW_MOUSE_BUTTON_1))
     {
+        _activity = true;
+
         double cursorX, cursorY;
         glfwGetCursorPos(window, &cursorX, &cursorY);
 
-        float cellPixelSizeX = (float)WINDOW_WIDTH / (float)SIMULATION_GRID_WIDTH;
-        float cellPixelSizeY = (float)WINDOW_HEIGHT / (float)SIMULATION_GRID_HEIGHT;
+        int windowWidth, windowHeight;
+        glfwGetWindowSize(window, &windowWidth, &windowHeight);
+        if (windowWidth <= 0 || windowHeight <= 0) { return; }
 
-        int gridX = (int)(cursorX / cellPixelSizeX);
-        int gridY = (int)(cursorY / cellPixelSizeY);
+        // Cursor through the camera into world space, then into grid cells
+        glm::vec2 cursorWorld = _camera->screenToWorld(cursorX, cursorY, windowWidth, windowHeight);
+        int gridX = (int)std::floor((cursorWorld.x + 1.0f) / _sim->getCellSize());
+        int gridY = (int)std::floor((1.0f - cursorWorld.y) / _sim->getCellSize());
 
+        stampBrush(_sim, gridX, gridY, selectedType);
+        if (_latency != nullptr) { _latency->onEdit(); }
+    }
+}
 
-        for (int dy = BRUSH_SIZE / 2 * -1; dy <= BRUSH_SIZE / 2; ++dy) {
-            for (int dx = BRUSH_SIZE / 2 * -1; dx <= BRUSH_SIZE / 2; ++dx) {
+void InputManager::stampBrush(Simulation* sim, int gridX, int gridY, Simulation::TileType type)
+{
+    for (int dy = BRUSH_SIZE / 2 * -1; dy <= BRUSH_SIZE / 2; ++dy) {
+        for (int dx = BRUSH_SIZE / 2 * -1; dx <= BRUSH_SIZE / 2; ++dx) {
 
-                if (dist(rng) < BRUSH_DENSITY)
+            if (dist(rng) < BRUSH_DENSITY)
+            {
+                if (sim->isValidTile(gridX + dx, gridY + dy))
                 {
-                    if (_sim->isValidTile(gridX + dx, gridY + dy))
-                    {
-                        _sim->setTile(gridX + dx, gridY + dy, selectedType);
+                    sim->setTile(gridX + dx, gridY + dy, type);
 
-                    }
                 }
             }
         }
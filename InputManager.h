@@ -2,21 +2,40 @@
 
 #include <GLFW/glfw3.h>
 #include "Simulation.h"
+#include "Camera.h"
+
+class LatencyTracker;
 
 class InputManager
 {
 	public:
 	Simulation::TileType selectedType = Simulation::TILE_SAND;
+	bool recording = false; // Toggled with CAPTURE_KEY
+	bool traceRequested = false; // Set by TRACE_KEY, cleared by whoever starts the trace
 
-	InputManager(GLFWwindow* window, Simulation* sim);
+	InputManager(GLFWwindow* window, Simulation* sim, Camera* camera);
 	bool isKeyPressed(int key);
 	bool isMousePressed(int key);
 	void toggleWireframe(bool _isEnabled);
 	void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+	void scroll_callback(GLFWwindow* window, double xOffset, double yOffset);
 	void processInput(GLFWwindow* window);
+	// Scatters BRUSH_DENSITY of a BRUSH_SIZE square around the cell, what a click paints
+	static void stampBrush(Simulation* sim, int gridX, int gridY, Simulation::TileType type);
+	// True if there was any input (events, brush, camera) since the last call
+	bool consumeActivity();
+	void setLatencyTracker(LatencyTracker* latency) { _latency = latency; }
 
 	private:
 	GLFWwindow* _window;
 	Simulation* _sim;
+	Camera* _camera;
+	double _pendingScroll = 0.0;  // Wheel notches since the last processInput
+	bool _activity = true;
+	LatencyTracker* _latency = nullptr;
+	bool _panning = false;
+	double _panCursorX, _panCursorY;
+
+	void updateCamera(GLFWwindow* window);
 };
 
@@ -0,0 +1,122 @@
+#include "InstanceSlots.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include <algorithm>
+
+InstanceSlots::InstanceSlots(Simulation* sim)
+{
+    _sim = sim;
+
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_INSTANCE_DATA);
+    int cellCount = sim->getWidth() * sim->getHeight();
+    _slotOfCell.assign(cellCount, -1);
+    _freeSlots.reserve(cellCount);
+    _positions.resize(cellCount);
+    _types.resize(cellCount);
+    _dirtySlots.reserve(cellCount);
+    _slotDirty.assign(cellCount, 0);
+    _dirtyRanges.reserve(cellCount / 2 + 1);
+}
+
+void InstanceSlots::rebuild()
+{
+    PROFILE_ZONE("instance data");
+    std::fill(_slotOfCell.begin(), _slotOfCell.end(), -1);
+    _freeSlots.clear();
+    _slotCount = 0;
+
+    int width = _sim->getWidth();
+    for (int y = 0; y < _sim->getHeight(); ++y) {
+        for (int x = 0; x < width; ++x) {
+            Simulation::TileType tile = _sim->getTile(x, y);
+            if (tile != Simulation::TILE_EMPTY) {
+                writeSlot(_slotCount++, y * width + x, tile);
+            }
+        }
+    }
+
+    clearDirty();
+    _fullUpload = true;
+}
+
+void InstanceSlots::applyChanges()
+{
+    PROFILE_ZONE("instance data");
+    int width = _sim->getWidth();
+    const int* changedCells = _sim->getChangedCells();
+    int changedCount = _sim->getChangedCount();
+
+    for (int i = 0; i < changedCount; ++i) {
+        int cell = changedCells[i];
+        Simulation::TileType tile = _sim->getTile(cell % width, cell / width);
+        int slot = _slotOfCell[cell];
+
+        if (tile == Simulation::TILE_EMPTY) {
+            if (slot < 0) { continue; }
+
+            // Free the slot, the vertex shader collapses TILE_EMPTY instances
+            _slotOfCell[cell] = -1;
+            _types[slot] = Simulation::TILE_EMPTY;
+            _freeSlots.push_back(slot);
+            if (!_slotDirty[slot]) { _slotDirty[slot] = 1; _dirtySlots.push_back(slot); }
+        }
+        else if (slot < 0) {
+            if (!_freeSlots.empty()) {
+                slot = _freeSlots.back();
+                _freeSlots.pop_back();
+            }
+            else {
+                slot = _slotCount++;
+            }
+            writeSlot(slot, cell, tile);
+        }
+        else if (_types[slot] != tile) {
+            _types[slot] = tile;
+            if (!_slotDirty[slot]) { _slotDirty[slot] = 1; _dirtySlots.push_back(slot); }
+        }
+    }
+    _sim->clearChanges();
+
+    // Holes cost a vertex shader run each, repack once they outnumber live cells
+    if ((int)_freeSlots.size() > _slotCount / 2 && _slotCount > 1024) {
+        rebuild();
+    }
+}
+
+const std::vector<InstanceSlots::Range>& InstanceSlots::getDirtyRanges()
+{
+    _dirtyRanges.clear();
+    std::sort(_dirtySlots.begin(), _dirtySlots.end());
+
+    for (int slot : _dirtySlots) {
+        if (!_dirtyRanges.empty() && slot - _dirtyRanges.back().end <= RANGE_MERGE_GAP) {
+            _dirtyRanges.back().end = slot + 1;
+        }
+        else {
+            _dirtyRanges.push_back({ slot, slot + 1 });
+        }
+    }
+    return _dirtyRanges;
+}
+
+void InstanceSlots::clearDirty()
+{
+    for (int slot : _dirtySlots) {
+        _slotDirty[slot] = 0;
+    }
+    _dirtySlots.clear();
+    _fullUpload = false;
+}
+
+void InstanceSlots::writeSlot(int slot, int cell, Simulation::TileType type)
+{
+    int width = _sim->getWidth();
+    float cellSize = _sim->getCellSize();
+    int x = cell % width;
+    int y = cell / width;
+
+    _slotOfCell[cell] = slot;
+    _positions[slot] = glm::vec2((x * cellSize) - 1.0f + (cellSize / 2.0f), 1.0f - (y * cellSize) - (cellSize / 2.0f));
+    _types[slot] = type;
+    if (!_slotDirty[slot]) { _slotDirty[slot] = 1; _dirtySlots.push_back(slot); }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Simulation.h"
+
+// Persistent instance data with a stable slot per occupied cell.
+// Slots are updated from the simulation's change list instead of being rebuilt
+// every frame, and the slots touched since the last upload are reported as
+// coalesced ranges so only those need to be sent to the GPU.
+class InstanceSlots
+{
+public:
+	struct Range
+	{
+		int begin;
+		int end;
+	};
+
+	InstanceSlots(Simulation* sim);
+
+	void rebuild();
+	void applyChanges();
+
+	int getSlotCount() { return _slotCount; } // Draw count, freed slots in between hold TILE_EMPTY
+	int getOccupiedCount() { return _slotCount - (int)_freeSlots.size(); }
+	const glm::vec2* getPositions() { return _positions.data(); }
+	const Simulation::TileType* getTypes() { return _types.data(); }
+
+	bool needsFullUpload() { return _fullUpload; }
+	const std::vector<Range>& getDirtyRanges(); // Sorted, merged ranges of slots written since clearDirty()
+	void clearDirty();
+
+private:
+	static const int RANGE_MERGE_GAP = 64; // Slots between two dirty runs before they become separate uploads
+
+	Simulation* _sim;
+	std::vector<int> _slotOfCell; // -1 when the cell has no slot
+	std::vector<int> _freeSlots;
+	std::vector<glm::vec2> _positions;
+	std::vector<Simulation::TileType> _types;
+	int _slotCount = 0;
+
+	std::vector<int> _dirtySlots;
+	std::vector<uint8_t> _slotDirty;
+	std::vector<Range> _dirtyRanges;
+	bool _fullUpload = true;
+
+	void writeSlot(int slot, int cell, Simulation::TileType type);
+};
@@ -0,0 +1,121 @@
+#include "LatencyTracker.h"
+#include <GLFW/glfw3.h>
+
+const char* const LatencyTracker::STAGE_NAMES[STAGE_COUNT] = {
+    "edit", "upload", "swap", "gpu", "tick"
+};
+
+LatencyTracker::LatencyTracker()
+{
+    // Timestamp queries are core since 3.3
+    _gpuTimestamps = GLAD_GL_VERSION_3_3 != 0;
+    for (Stroke& stroke : _strokes) {
+        if (_gpuTimestamps) { glGenQueries(1, &stroke.query); }
+    }
+}
+
+LatencyTracker::~LatencyTracker()
+{
+    for (Stroke& stroke : _strokes) {
+        if (stroke.query != 0) { glDeleteQueries(1, &stroke.query); }
+    }
+}
+
+void LatencyTracker::beginFrame()
+{
+    double now = glfwGetTime();
+
+    // Both clocks drift a little, so the mapping is refreshed once a second
+    if (_gpuTimestamps && (_lastSync < 0.0 || now - _lastSync > 1.0)) {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        _gpuOffset = glfwGetTime() - (double)gpuNow * 1e-9;
+        _lastSync = now;
+    }
+
+    // Events the previous frame didn't write (the GUI had the mouse) aren't strokes
+    if (_pendingInput >= 0.0 && _pendingInput < _frameStart) { _pendingInput = -1.0; }
+    _frameStart = now;
+    _current = nullptr;
+
+    for (Stroke& stroke : _strokes) {
+        if (!stroke.active || !stroke.queryPending) { continue; }
+
+        GLint available = 0;
+        glGetQueryObjectiv(stroke.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) { continue; }
+
+        GLuint64 gpuTime = 0;
+        glGetQueryObjectui64v(stroke.query, GL_QUERY_RESULT, &gpuTime);
+        stroke.queryPending = false;
+        stroke.times[STAGE_GPU] = (double)gpuTime * 1e-9 + _gpuOffset;
+        finishIfDone(stroke);
+    }
+}
+
+void LatencyTracker::onInput()
+{
+    if (_pendingInput < 0.0) { _pendingInput = glfwGetTime(); }
+}
+
+void LatencyTracker::onEdit()
+{
+    if (_pendingInput < 0.0 || _current != nullptr) { return; }
+
+    // The oldest stroke gives way when more than MAX_STROKES are in flight
+    Stroke& stroke = _strokes[_nextStroke];
+    _nextStroke = (_nextStroke + 1) % MAX_STROKES;
+    stroke.active = true;
+    stroke.queryPending = false;
+    for (double& time : stroke.times) { time = -1.0; }
+    stroke.input = _pendingInput;
+    stroke.tickCount = _lastTickCount;
+    stroke.times[STAGE_EDIT] = glfwGetTime();
+
+    _pendingInput = -1.0;
+    _current = &stroke;
+}
+
+void LatencyTracker::onSimulation(uint32_t tickCount)
+{
+    double now = glfwGetTime();
+    for (Stroke& stroke : _strokes) {
+        if (stroke.active && stroke.times[STAGE_TICK] < 0.0 && tickCount != stroke.tickCount) {
+            stroke.times[STAGE_TICK] = now;
+            finishIfDone(stroke);
+        }
+    }
+    _lastTickCount = tickCount;
+}
+
+void LatencyTracker::onUpload()
+{
+    if (_current != nullptr) { _current->times[STAGE_UPLOAD] = glfwGetTime(); }
+}
+
+void LatencyTracker::onSubmit()
+{
+    if (_current == nullptr || !_gpuTimestamps) { return; }
+    glQueryCounter(_current->query, GL_TIMESTAMP);
+    _current->queryPending = true;
+}
+
+void LatencyTracker::onSwap()
+{
+    if (_current == nullptr) { return; }
+    _current->times[STAGE_SWAP] = glfwGetTime();
+    finishIfDone(*_current);
+}
+
+void LatencyTracker::finishIfDone(Stroke& stroke)
+{
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        if (stage == STAGE_GPU && !_gpuTimestamps) { continue; }
+        if (stroke.times[stage] < 0.0) { return; }
+    }
+
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        if (stroke.times[stage] >= 0.0) { _histograms[stage].record((stroke.times[stage] - stroke.input) * 1000.0); }
+    }
+    stroke.active = false;
+}
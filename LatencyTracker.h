@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "FrameStats.h"
+
+// Follows brush input through the frame pipeline and keeps the delay of each stage as a
+// distribution. A stroke starts at the first brush event GLFW delivers (GLFW has no OS event
+// timestamps, so time spent queued before glfwPollEvents is not seen) and is then stamped when
+// processInput writes the cells, when the instances holding them are uploaded, when the frame
+// is swapped and when the GPU has finished that frame (a GL_TIMESTAMP query mapped onto the CPU
+// clock; without timer queries that stage stays empty). The first simulation tick after the
+// edit, when the new cells start falling, is tracked separately.
+class LatencyTracker
+{
+public:
+	enum Stage {
+		STAGE_EDIT = 0,
+		STAGE_UPLOAD,
+		STAGE_SWAP,
+		STAGE_GPU,
+		STAGE_TICK,
+		STAGE_COUNT
+	};
+	static const char* const STAGE_NAMES[STAGE_COUNT];
+
+	LatencyTracker();
+	~LatencyTracker();
+
+	// In frame order
+	void beginFrame(); // Collects finished GPU timestamps
+	void onInput(); // From the event callbacks
+	void onEdit(); // The brush wrote cells
+	void onSimulation(uint32_t tickCount);
+	void onUpload();
+	void onSubmit(); // Before the swap, after the last draw of the frame
+	void onSwap();
+
+	TimeHistogram& getHistogram(Stage stage) { return _histograms[stage]; } // Milliseconds from the input event
+	bool hasGpuTimestamps() { return _gpuTimestamps; }
+
+private:
+	static const int MAX_STROKES = 8;
+
+	struct Stroke
+	{
+		bool active = false;
+		double times[STAGE_COUNT]; // Seconds on the glfwGetTime clock, negative until reached
+		double input = 0.0;
+		uint32_t tickCount = 0; // Simulation ticks done before the edit
+		GLuint query = 0;
+		bool queryPending = false;
+	};
+
+	Stroke _strokes[MAX_STROKES];
+	Stroke* _current = nullptr; // Stroke edited this frame
+	int _nextStroke = 0;
+	double _pendingInput = -1.0; // Oldest brush event not yet written to the grid
+	double _frameStart = 0.0;
+	uint32_t _lastTickCount = 0;
+
+	bool _gpuTimestamps = false;
+	double _gpuOffset = 0.0; // CPU seconds minus GPU seconds
+	double _lastSync = -1.0;
+
+	TimeHistogram _histograms[STAGE_COUNT];
+
+	void finishIfDone(Stroke& stroke);
+};
@@ -0,0 +1,275 @@
+#define _CRT_SECURE_NO_WARNINGS // writeReport uses std::fopen, /sdl rejects it otherwise
+#include "MemoryTracker.h"
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+size_t MemoryTracker::_frameStartCount = 0;
+size_t MemoryTracker::_frameAllocations = 0;
+size_t MemoryTracker::_frameCount = 0;
+size_t MemoryTracker::_tagFrameStart[TAG_COUNT] = {};
+size_t MemoryTracker::_tagFrameAllocations[TAG_COUNT] = {};
+
+static const char* TAG_NAMES[MemoryTracker::TAG_COUNT] = {
+    "untagged", "simulation", "instance_data", "gui", "shaders", "io"
+};
+
+namespace
+{
+    struct TagCounters
+    {
+        std::atomic<size_t> liveBytes;
+        std::atomic<size_t> peakBytes;
+        std::atomic<size_t> externalBytes;
+        std::atomic<size_t> allocations;
+    };
+
+    // Zero-initialized before any constructor runs, so early allocations are safe
+    TagCounters tagCounters[MemoryTracker::TAG_COUNT];
+    std::atomic<size_t> allocationCount;
+    std::atomic<size_t> totalLiveBytes;
+    std::atomic<size_t> totalPeakBytes;
+    thread_local MemoryTracker::Tag currentTag = MemoryTracker::TAG_UNTAGGED;
+
+    void raisePeak(std::atomic<size_t>& peak, size_t value)
+    {
+        size_t current = peak.load(std::memory_order_relaxed);
+        while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+}
+
+#ifdef SANDBOX_TRACK_MEMORY
+
+// Every block carries its size and tag in front of the user pointer so frees can be charged back
+static const size_t HEADER_SIZE = 16;
+static const unsigned int HEADER_MAGIC = 0x5A4E4442;
+
+struct AllocationHeader
+{
+    size_t size;
+    unsigned int tag;
+    unsigned int magic;
+};
+
+static void* trackedAllocate(size_t size, MemoryTracker::Tag tag)
+{
+    char* block = static_cast<char*>(std::malloc(size + HEADER_SIZE));
+    if (block == nullptr) { return nullptr; }
+
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block);
+    header->size = size;
+    header->tag = tag;
+    header->magic = HEADER_MAGIC;
+
+    TagCounters& counters = tagCounters[tag];
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    raisePeak(counters.peakBytes, counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size);
+    raisePeak(totalPeakBytes, totalLiveBytes.fetch_add(size, std::memory_order_relaxed) + size);
+
+    return block + HEADER_SIZE;
+}
+
+static void trackedRelease(void* memory)
+{
+    if (memory == nullptr) { return; }
+
+    char* block = static_cast<char*>(memory) - HEADER_SIZE;
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block);
+    assert(header->magic == HEADER_MAGIC && "Freeing a block the memory tracker didn't allocate");
+
+    tagCounters[header->tag].liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+    totalLiveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+    header->magic = 0;
+    std::free(block);
+}
+
+#elif defined(SANDBOX_COUNT_ALLOCATIONS)
+
+static void* trackedAllocate(size_t size, MemoryTracker::Tag tag)
+{
+    tagCounters[tag].allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size);
+}
+
+static void trackedRelease(void* memory)
+{
+    std::free(memory);
+}
+
+#else
+
+static void* trackedAllocate(size_t size, MemoryTracker::Tag)
+{
+    return std::malloc(size);
+}
+
+static void trackedRelease(void* memory)
+{
+    std::free(memory);
+}
+
+#endif
+
+#ifdef SANDBOX_COUNT_ALLOCATIONS
+
+// Only operator new feeds the global count, library hooks are reported per tag
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* memory = trackedAllocate(size != 0 ? size : 1, currentTag);
+    if (memory == nullptr) { throw std::bad_alloc(); }
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    trackedRelease(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    trackedRelease(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    trackedRelease(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    trackedRelease(memory);
+}
+
+#endif
+
+MemoryTracker::Scope::Scope(Tag tag)
+{
+    _previous = currentTag;
+    currentTag = tag;
+}
+
+MemoryTracker::Scope::~Scope()
+{
+    currentTag = _previous;
+}
+
+bool MemoryTracker::isEnabled()
+{
+#ifdef SANDBOX_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MemoryTracker::isTrackingBytes()
+{
+#ifdef SANDBOX_TRACK_MEMORY
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t MemoryTracker::getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+const char* MemoryTracker::getTagName(Tag tag)
+{
+    return TAG_NAMES[tag];
+}
+
+MemoryTracker::TagStats MemoryTracker::getTagStats(Tag tag)
+{
+    TagStats stats;
+    stats.liveBytes = tagCounters[tag].liveBytes.load(std::memory_order_relaxed);
+    stats.peakBytes = tagCounters[tag].peakBytes.load(std::memory_order_relaxed);
+    stats.externalBytes = tagCounters[tag].externalBytes.load(std::memory_order_relaxed);
+    stats.allocations = tagCounters[tag].allocations.load(std::memory_order_relaxed);
+    stats.frameAllocations = _tagFrameAllocations[tag];
+    return stats;
+}
+
+size_t MemoryTracker::getLiveBytes()
+{
+    return totalLiveBytes.load(std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::getPeakBytes()
+{
+    return totalPeakBytes.load(std::memory_order_relaxed);
+}
+
+void MemoryTracker::setExternalBytes(Tag tag, size_t bytes)
+{
+    tagCounters[tag].externalBytes.store(bytes, std::memory_order_relaxed);
+}
+
+void* MemoryTracker::allocate(size_t size, Tag tag)
+{
+    return trackedAllocate(size, tag);
+}
+
+void MemoryTracker::release(void* memory)
+{
+    trackedRelease(memory);
+}
+
+void MemoryTracker::beginFrame()
+{
+    _frameStartCount = getAllocationCount();
+    for (int tag = 0; tag < TAG_COUNT; ++tag) {
+        _tagFrameStart[tag] = tagCounters[tag].allocations.load(std::memory_order_relaxed);
+    }
+}
+
+size_t MemoryTracker::endFrame(bool steadyState)
+{
+    _frameAllocations = getAllocationCount() - _frameStartCount;
+    for (int tag = 0; tag < TAG_COUNT; ++tag) {
+        _tagFrameAllocations[tag] = tagCounters[tag].allocations.load(std::memory_order_relaxed) - _tagFrameStart[tag];
+    }
+    _frameCount++;
+
+    assert((!steadyState || _frameAllocations == 0) && "Heap allocation during a steady-state frame");
+    return _frameAllocations;
+}
+
+bool MemoryTracker::writeReport(const char* path)
+{
+    FILE* file = std::fopen(path, "w");
+    if (file == nullptr) { return false; }
+
+    double frames = _frameCount > 0 ? (double)_frameCount : 1.0;
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"frames\": %zu,\n", _frameCount);
+    std::fprintf(file, "  \"trackingBytes\": %s,\n", isTrackingBytes() ? "true" : "false");
+    std::fprintf(file, "  \"liveBytes\": %zu,\n", getLiveBytes());
+    std::fprintf(file, "  \"peakBytes\": %zu,\n", getPeakBytes());
+    std::fprintf(file, "  \"allocations\": %zu,\n", getAllocationCount());
+    std::fprintf(file, "  \"allocationsPerFrame\": %.3f,\n", getAllocationCount() / frames);
+    std::fprintf(file, "  \"tags\": [\n");
+    for (int tag = 0; tag < TAG_COUNT; ++tag) {
+        TagStats stats = getTagStats((Tag)tag);
+        std::fprintf(file, "    { \"name\": \"%s\", \"liveBytes\": %zu, \"peakBytes\": %zu, \"externalBytes\": %zu, "
+            "\"allocations\": %zu, \"allocationsPerFrame\": %.3f, \"lastFrameAllocations\": %zu }%s\n",
+            TAG_NAMES[tag], stats.liveBytes, stats.peakBytes, stats.externalBytes,
+            stats.allocations, stats.allocations / frames, stats.frameAllocations, tag + 1 < TAG_COUNT ? "," : "");
+    }
+    std::fprintf(file, "  ]\n");
+    std::fprintf(file, "}\n");
+
+    std::fclose(file);
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+
+// Define SANDBOX_TRACK_MEMORY to tag every heap allocation with the subsystem that
+// made it (live bytes, peak, allocations per frame, JSON report at exit).
+// Debug builds always hook the global operator new/delete to count heap traffic.
+#if (defined(_DEBUG) || defined(SANDBOX_TRACK_MEMORY)) && !defined(SANDBOX_COUNT_ALLOCATIONS)
+#define SANDBOX_COUNT_ALLOCATIONS
+#endif
+
+// Counts global heap allocations so steady-state frames can be checked for
+// allocation regressions. Without SANDBOX_COUNT_ALLOCATIONS all counts stay 0.
+class MemoryTracker
+{
+public:
+	enum Tag {
+		TAG_UNTAGGED = 0,
+		TAG_SIMULATION,
+		TAG_INSTANCE_DATA,
+		TAG_GUI,
+		TAG_SHADERS,
+		TAG_IO,
+		TAG_COUNT
+	};
+
+	struct TagStats
+	{
+		size_t liveBytes = 0;
+		size_t peakBytes = 0;
+		size_t externalBytes = 0; // Memory the subsystem maps itself (chunk slabs, ...)
+		size_t allocations = 0;
+		size_t frameAllocations = 0;
+	};
+
+	// Allocations made while a Scope is alive are charged to its tag
+	class Scope
+	{
+	public:
+		Scope(Tag tag);
+		~Scope();
+
+	private:
+		Tag _previous;
+	};
+
+	static bool isEnabled();
+	static bool isTrackingBytes();
+	static size_t getAllocationCount();
+
+	static const char* getTagName(Tag tag);
+	static TagStats getTagStats(Tag tag);
+	static size_t getLiveBytes();
+	static size_t getPeakBytes();
+	static void setExternalBytes(Tag tag, size_t bytes);
+
+	// Tagged malloc/free for libraries with their own allocator hooks (ImGui)
+	static void* allocate(size_t size, Tag tag);
+	static void release(void* memory);
+
+	static void beginFrame();
+	static size_t endFrame(bool steadyState); // Asserts when a steady-state frame allocated
+
+	static size_t getFrameAllocations() { return _frameAllocations; }
+	static size_t getFrameCount() { return _frameCount; }
+
+	static bool writeReport(const char* path);
+
+private:
+	static size_t _frameStartCount;
+	static size_t _frameAllocations;
+	static size_t _frameCount;
+	static size_t _tagFrameStart[TAG_COUNT];
+	static size_t _tagFrameAllocations[TAG_COUNT];
+};
@@ -0,0 +1,543 @@
+#define _CRT_SECURE_NO_WARNINGS // fopen for the report
+#include "Microbench.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include "CommandLine.h"
+#include "Config.h"
+#include "Simulation.h"
+#include "Snapshot.h"
+#include "Scenario.h"
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
+#include "InputManager.h"
+#include "Headless.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct Setup
+    {
+        int width, height, threads;
+    };
+
+    enum Fill {
+        FILL_EMPTY,
+        FILL_SAND,
+        FILL_WATER,
+        FILL_HALF, // Sand over water, sinks through it
+        FILL_RANDOM // Half the cells, sand or water
+    };
+
+    void fill(Simulation& sim, Fill pattern, std::mt19937& rng)
+    {
+        for (int y = 0; y < sim.getHeight(); ++y) {
+            for (int x = 0; x < sim.getWidth(); ++x) {
+                Simulation::TileType type = Simulation::TILE_EMPTY;
+                switch (pattern) {
+                case FILL_SAND: type = Simulation::TILE_SAND; break;
+                case FILL_WATER: type = Simulation::TILE_WATER; break;
+                case FILL_HALF: type = (y < sim.getHeight() / 2) ? Simulation::TILE_SAND : Simulation::TILE_WATER; break;
+                case FILL_RANDOM:
+                    if (rng() & 1) { type = (rng() & 1) ? Simulation::TILE_SAND : Simulation::TILE_WATER; }
+                    break;
+                default: break;
+                }
+                if (type != Simulation::TILE_EMPTY) { sim.setTile(x, y, type); }
+            }
+        }
+    }
+
+    // One case on one setup. prepare() is untimed and runs before every repetition, run() is
+    // timed and returns how many items (cells, stamps, bytes) it processed.
+    class Bench
+    {
+    public:
+        virtual ~Bench() {}
+        virtual void prepare() {}
+        virtual double run() = 0;
+    };
+
+    // Every other row sand, every move straight down into the empty row below succeeds.
+    // Both generations are restored before each repetition, as step() would have copied them.
+    class MoveTileBench : public Bench
+    {
+    public:
+        MoveTileBench(const Setup& setup) : _sim(setup.width, setup.height) {}
+
+        void prepare() override
+        {
+            for (int y = 0; y < _sim.getHeight(); ++y) {
+                Simulation::TileType type = (y % 2 == 0 && y + 1 < _sim.getHeight()) ? Simulation::TILE_SAND : Simulation::TILE_EMPTY;
+                for (int x = 0; x < _sim.getWidth(); ++x) {
+                    _sim.setTile(x, y, type);
+                    if (_sim.getChunkTiles(x / SIMULATION_CHUNK_SIZE, y / SIMULATION_CHUNK_SIZE) != nullptr) { _sim.setNextTile(x, y, type); }
+                }
+            }
+        }
+
+        double run() override
+        {
+            int moves = 0;
+            for (int y = 0; y + 1 < _sim.getHeight(); y += 2) {
+                for (int x = 0; x < _sim.getWidth(); ++x) { moves += _sim.moveTile(x, y, 0, 1); }
+            }
+            return moves;
+        }
+
+    private:
+        Simulation _sim;
+    };
+
+    // The striped engine gets a pool of setup.threads workers, the serial engine none
+    ThreadPool* createEnginePool(const Setup& setup, Simulation::Engine engine)
+    {
+        return (engine == Simulation::ENGINE_STRIPED) ? new ThreadPool(setup.threads) : nullptr;
+    }
+
+    // Every repetition steps the filled grid, restored from a snapshot, and the same rain drops.
+    // The hashed and unhashed cases force the state hash upkeep on and off, the A/B of what it costs.
+    class StepBench : public Bench
+    {
+    public:
+        StepBench(const Setup& setup, Fill pattern, bool rain, Simulation::Engine engine = Simulation::ENGINE_SERIAL,
+            Simulation::StateHashing hashing = Simulation::HASHING_SETTLING)
+            : _pool(createEnginePool(setup, engine)), _sim(setup.width, setup.height), _rain(rain)
+        {
+            _sim.setEngine(engine, _pool.get());
+            _sim.setStateHashing(hashing);
+            fill(_sim, pattern, _rng);
+            Snapshot::write(_sim, _start);
+        }
+
+        void prepare() override
+        {
+            Snapshot::read(_sim, _start.data(), _start.size());
+            _rng.seed(std::mt19937::default_seed);
+            if (_rain) { spawnHeadlessGrains(_sim, _rng, 0, INT_MAX); }
+        }
+
+        double run() override
+        {
+            _sim.step();
+            return (double)_sim.getWidth() * _sim.getHeight();
+        }
+
+    private:
+        std::unique_ptr<ThreadPool> _pool;
+        Simulation _sim;
+        std::mt19937 _rng;
+        bool _rain;
+        std::vector<uint8_t> _start;
+    };
+
+    // One tick of a scenario from its start state, fed by its sources as in the runners
+    class ScenarioBench : public Bench
+    {
+    public:
+        ScenarioBench(const Setup& setup, Scenario::Id id, Simulation::Engine engine = Simulation::ENGINE_SERIAL)
+            : _pool(createEnginePool(setup, engine)), _sim(setup.width, setup.height), _scenario(id), _startScenario(id)
+        {
+            _sim.setEngine(engine, _pool.get());
+            _startScenario.setUp(_sim);
+            Snapshot::write(_sim, _start);
+        }
+
+        // Back to the start grid, and the sources back to their first drops
+        void prepare() override
+        {
+            Snapshot::read(_sim, _start.data(), _start.size());
+            _scenario = _startScenario;
+            _scenario.update(_sim);
+        }
+
+        double run() override
+        {
+            _sim.step();
+            return (double)_sim.getWidth() * _sim.getHeight();
+        }
+
+    private:
+        std::unique_ptr<ThreadPool> _pool;
+        Simulation _sim;
+        Scenario _scenario;
+        Scenario _startScenario;
+        std::vector<uint8_t> _start;
+    };
+
+    class InstanceBench : public Bench
+    {
+    public:
+        InstanceBench(const Setup& setup, bool packed) : _sim(setup.width, setup.height), _packed(packed)
+        {
+            fill(_sim, FILL_RANDOM, _rng);
+            size_t cells = (size_t)setup.width * setup.height;
+            if (packed) { _instances.resize(cells); }
+            else {
+                _positions.resize(cells);
+                _types.resize(cells);
+            }
+        }
+
+        double run() override
+        {
+            if (_packed) { _sim.calculatePackedInstanceData(_instances.data()); }
+            else { _sim.calculateInstanceData(_positions.data(), _types.data()); }
+            return (double)_sim.getWidth() * _sim.getHeight();
+        }
+
+    private:
+        Simulation _sim;
+        std::mt19937 _rng;
+        bool _packed;
+        std::vector<uint32_t> _instances;
+        std::vector<glm::vec2> _positions;
+        std::vector<Simulation::TileType> _types;
+    };
+
+    class BrushBench : public Bench
+    {
+    public:
+        static const int STAMPS = 256;
+
+        BrushBench(const Setup& setup) : _sim(setup.width, setup.height)
+        {
+            std::mt19937 rng(1);
+            for (int i = 0; i < STAMPS; ++i) {
+                _centers.push_back((int)(rng() % (unsigned int)setup.width));
+                _centers.push_back((int)(rng() % (unsigned int)setup.height));
+            }
+        }
+
+        double run() override
+        {
+            for (int i = 0; i < STAMPS; ++i) { InputManager::stampBrush(&_sim, _centers[2 * i], _centers[2 * i + 1], Simulation::TILE_SAND); }
+            return STAMPS;
+        }
+
+    private:
+        Simulation _sim;
+        std::vector<int> _centers;
+    };
+
+    class SnapshotBench : public Bench
+    {
+    public:
+        enum Mode { MODE_WRITE, MODE_READ, MODE_FILE };
+
+        SnapshotBench(const Setup& setup, Mode mode) : _source(setup.width, setup.height), _target(setup.width, setup.height), _mode(mode)
+        {
+            std::mt19937 rng;
+            fill(_source, FILL_RANDOM, rng);
+            Snapshot::write(_source, _data);
+            Snapshot::write(_target, _empty);
+        }
+
+        ~SnapshotBench() { if (_mode == MODE_FILE) { std::remove(PATH); } }
+
+        void prepare() override
+        {
+            // Loading into an empty grid writes every cell, loading the same state again writes none
+            Snapshot::read(_target, _empty.data(), _empty.size());
+        }
+
+        double run() override
+        {
+            switch (_mode) {
+            case MODE_WRITE: Snapshot::write(_source, _data); break;
+            case MODE_READ: Snapshot::read(_target, _data.data(), _data.size()); break;
+            case MODE_FILE:
+                Snapshot::save(_source, PATH);
+                Snapshot::load(_target, PATH);
+                break;
+            }
+            return (double)_data.size();
+        }
+
+    private:
+        static const char* const PATH;
+        Simulation _source, _target;
+        Mode _mode;
+        std::vector<uint8_t> _data, _empty;
+    };
+    const char* const SnapshotBench::PATH = "microbench_snapshot.bin";
+
+    // Rain keeps chunks changing, so every frame reshades some of them as in the window
+    class SoftwareRenderBench : public Bench
+    {
+    public:
+        SoftwareRenderBench(const Setup& setup)
+            : _sim(setup.width, setup.height), _pool(setup.threads), _renderer(&_sim, &_pool, WINDOW_WIDTH, WINDOW_HEIGHT)
+        {
+            fill(_sim, FILL_RANDOM, _rng);
+        }
+
+        void prepare() override
+        {
+            spawnHeadlessGrains(_sim, _rng, 0, INT_MAX);
+            _sim.step();
+        }
+
+        double run() override
+        {
+            _renderer.render();
+            return (double)_renderer.getWidth() * _renderer.getHeight();
+        }
+
+    private:
+        Simulation _sim;
+        std::mt19937 _rng;
+        ThreadPool _pool;
+        SoftwareRenderer _renderer;
+    };
+
+    struct Case
+    {
+        const char* name;
+        const char* unit; // What run() counts
+        bool threaded; // Repeated for every --threads value
+        std::function<Bench*(const Setup&)> create;
+    };
+
+    const Case CASES[] = {
+        { "moveTile", "move", false, [](const Setup& s) { return new MoveTileBench(s); } },
+        { "step/empty", "cell", false, [](const Setup& s) { return new StepBench(s, FILL_EMPTY, false); } },
+        { "step/full sand", "cell", false, [](const Setup& s) { return new StepBench(s, FILL_SAND, false); } },
+        { "step/full water", "cell", false, [](const Setup& s) { return new StepBench(s, FILL_WATER, false); } },
+        { "step/half and half", "cell", false, [](const Setup& s) { return new StepBench(s, FILL_HALF, false); } },
+        { "step/rain", "cell", false, [](const Setup& s) { return new StepBench(s, FILL_EMPTY, true); } },
+        { "step/half and half hashed", "cell", false, [](const Setup& s) { return new StepBench(s, FILL_HALF, false, Simulation::ENGINE_SERIAL, Simulation::HASHING_ALWAYS); } },
+        { "step/half and half unhashed", "cell", false, [](const Setup& s) { return new StepBench(s, FILL_HALF, false, Simulation::ENGINE_SERIAL, Simulation::HASHING_OFF); } },
+        { "step/rain hashed", "cell", false, [](const Setup& s) { return new StepBench(s, FILL_EMPTY, true, Simulation::ENGINE_SERIAL, Simulation::HASHING_ALWAYS); } },
+        { "step/rain unhashed", "cell", false, [](const Setup& s) { return new StepBench(s, FILL_EMPTY, true, Simulation::ENGINE_SERIAL, Simulation::HASHING_OFF); } },
+        { "scenario/dam-break", "cell", false, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_DAM_BREAK); } },
+        { "scenario/hourglass", "cell", false, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_HOURGLASS); } },
+        { "scenario/rain", "cell", false, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_RAIN); } },
+        { "scenario/sand-into-lake", "cell", false, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_SAND_INTO_LAKE); } },
+        { "scenario/checkerboard", "cell", false, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_CHECKERBOARD); } },
+        { "scenario/avalanche", "cell", false, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_AVALANCHE); } },
+        { "scenario/drizzle", "cell", false, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_DRIZZLE); } },
+        { "step/empty striped", "cell", true, [](const Setup& s) { return new StepBench(s, FILL_EMPTY, false, Simulation::ENGINE_STRIPED); } },
+        { "step/full sand striped", "cell", true, [](const Setup& s) { return new StepBench(s, FILL_SAND, false, Simulation::ENGINE_STRIPED); } },
+        { "step/full water striped", "cell", true, [](const Setup& s) { return new StepBench(s, FILL_WATER, false, Simulation::ENGINE_STRIPED); } },
+        { "step/half and half striped", "cell", true, [](const Setup& s) { return new StepBench(s, FILL_HALF, false, Simulation::ENGINE_STRIPED); } },
+        { "step/rain striped", "cell", true, [](const Setup& s) { return new StepBench(s, FILL_EMPTY, true, Simulation::ENGINE_STRIPED); } },
+        { "scenario/dam-break striped", "cell", true, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_DAM_BREAK, Simulation::ENGINE_STRIPED); } },
+        { "scenario/hourglass striped", "cell", true, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_HOURGLASS, Simulation::ENGINE_STRIPED); } },
+        { "scenario/rain striped", "cell", true, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_RAIN, Simulation::ENGINE_STRIPED); } },
+        { "scenario/sand-into-lake striped", "cell", true, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_SAND_INTO_LAKE, Simulation::ENGINE_STRIPED); } },
+        { "scenario/checkerboard striped", "cell", true, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_CHECKERBOARD, Simulation::ENGINE_STRIPED); } },
+        { "scenario/avalanche striped", "cell", true, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_AVALANCHE, Simulation::ENGINE_STRIPED); } },
+        { "scenario/drizzle striped", "cell", true, [](const Setup& s) { return new ScenarioBench(s, Scenario::SCENARIO_DRIZZLE, Simulation::ENGINE_STRIPED); } },
+        { "instances/quads", "cell", false, [](const Setup& s) { return new InstanceBench(s, false); } },
+        { "instances/packed", "cell", false, [](const Setup& s) { return new InstanceBench(s, true); } },
+        { "brush", "stamp", false, [](const Setup& s) { return new BrushBench(s); } },
+        { "snapshot/write", "byte", false, [](const Setup& s) { return new SnapshotBench(s, SnapshotBench::MODE_WRITE); } },
+        { "snapshot/read", "byte", false, [](const Setup& s) { return new SnapshotBench(s, SnapshotBench::MODE_READ); } },
+        { "snapshot/file", "byte", false, [](const Setup& s) { return new SnapshotBench(s, SnapshotBench::MODE_FILE); } },
+        { "software render", "pixel", true, [](const Setup& s) { return new SoftwareRenderBench(s); } },
+    };
+
+    struct Result
+    {
+        const Case* benchCase;
+        Setup setup;
+        double items;
+        double minMs, medianMs, meanMs, stddevMs, p90Ms, maxMs;
+
+        std::string getKey() const
+        {
+            char key[128];
+            std::snprintf(key, sizeof(key), "%s|%dx%d|%d", benchCase->name, setup.width, setup.height, setup.threads);
+            return key;
+        }
+    };
+
+    void summarize(std::vector<double>& times, Result& result)
+    {
+        std::sort(times.begin(), times.end());
+        size_t count = times.size();
+        double sum = 0.0, squares = 0.0;
+        for (double time : times) { sum += time; }
+        result.meanMs = sum / count;
+        for (double time : times) { squares += (time - result.meanMs) * (time - result.meanMs); }
+
+        result.minMs = times.front();
+        result.maxMs = times.back();
+        result.medianMs = (count % 2) ? times[count / 2] : 0.5 * (times[count / 2 - 1] + times[count / 2]);
+        result.p90Ms = times[std::min(count - 1, (size_t)std::ceil(0.9 * count) - 1)];
+        result.stddevMs = (count > 1) ? std::sqrt(squares / (count - 1)) : 0.0;
+    }
+
+    // Reads back our own --out format, one result object per line
+    std::map<std::string, double> readBaseline(const char* path, bool& ok)
+    {
+        std::map<std::string, double> medians;
+        FILE* file = std::fopen(path, "r");
+        ok = (file != nullptr);
+        if (!ok) { return medians; }
+
+        char line[1024];
+        while (std::fgets(line, sizeof(line), file) != nullptr) {
+            char name[128], grid[32];
+            int threads;
+            double median;
+            const char* result = std::strstr(line, "{\"name\":\"");
+            const char* medianField = std::strstr(line, "\"medianMs\":");
+            if (result == nullptr || medianField == nullptr) { continue; }
+            if (std::sscanf(result, "{\"name\":\"%127[^\"]\",\"grid\":\"%31[^\"]\",\"threads\":%d", name, grid, &threads) != 3) { continue; }
+            if (std::sscanf(medianField, "\"medianMs\":%lf", &median) != 1) { continue; }
+            medians[std::string(name) + "|" + grid + "|" + std::to_string(threads)] = median;
+        }
+        std::fclose(file);
+        return medians;
+    }
+
+    bool writeReport(const char* path, const MicrobenchOptions& options, const std::vector<Result>& results)
+    {
+        FILE* file = std::fopen(path, "w");
+        if (file == nullptr) { return false; }
+
+        std::fprintf(file, "{\n  \"warmup\": %d,\n  \"repeat\": %d,\n  \"results\": [\n", options.warmup, options.repeat);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            std::fprintf(file, "    {\"name\":\"%s\",\"grid\":\"%dx%d\",\"threads\":%d,\"unit\":\"%s\",\"items\":%.0f,"
+                "\"minMs\":%.6f,\"medianMs\":%.6f,\"meanMs\":%.6f,\"stddevMs\":%.6f,\"p90Ms\":%.6f,\"maxMs\":%.6f,\"nsPerItem\":%.4f}%s\n",
+                result.benchCase->name, result.setup.width, result.setup.height, result.setup.threads, result.benchCase->unit, result.items,
+                result.minMs, result.medianMs, result.meanMs, result.stddevMs, result.p90Ms, result.maxMs,
+                (result.items > 0.0) ? result.medianMs * 1e6 / result.items : 0.0, (i + 1 < results.size()) ? "," : "");
+        }
+        std::fprintf(file, "  ]\n}\n");
+
+        bool ok = !std::ferror(file);
+        std::fclose(file);
+        return ok;
+    }
+}
+
+bool MicrobenchOptions::parse(int argc, char** argv)
+{
+    grids.push_back({ SIMULATION_GRID_WIDTH, SIMULATION_GRID_HEIGHT });
+    threads.push_back(1);
+    outPath = MICROBENCH_REPORT_PATH;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--microbench") == 0) { continue; }
+
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            std::cerr << "Error: Missing value for " << arg << "\n";
+            return false;
+        }
+
+        bool ok = true;
+        if (std::strcmp(arg, "--grid") == 0) {
+            grids.clear();
+            for (const char* part = value; ok && *part != '\0';) {
+                GridSize grid;
+                int length = 0;
+                ok = std::sscanf(part, "%dx%d%n", &grid.width, &grid.height, &length) == 2 && grid.width > 0 && grid.height > 0;
+                grids.push_back(grid);
+                part += length;
+                if (*part == ',') { ++part; }
+                else if (*part != '\0') { ok = false; }
+            }
+        }
+        else if (std::strcmp(arg, "--threads") == 0) { ok = parseList(value, threads); }
+        else if (std::strcmp(arg, "--filter") == 0) { filter = value; }
+        else if (std::strcmp(arg, "--warmup") == 0) { warmup = std::max(0, std::atoi(value)); }
+        else if (std::strcmp(arg, "--repeat") == 0) { repeat = std::max(1, std::atoi(value)); }
+        else if (std::strcmp(arg, "--out") == 0) { outPath = value; }
+        else if (std::strcmp(arg, "--baseline") == 0) { baselinePath = value; }
+        else if (std::strcmp(arg, "--threshold") == 0) { threshold = std::atof(value); }
+        else { ok = false; }
+
+        if (!ok) {
+            std::cerr << "Error: Bad option " << arg << " " << value << "\n";
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+int runMicrobench(int argc, char** argv)
+{
+    MicrobenchOptions options;
+    if (!options.parse(argc, argv)) { return 1; }
+
+    std::map<std::string, double> baseline;
+    if (!options.baselinePath.empty()) {
+        bool ok;
+        baseline = readBaseline(options.baselinePath.c_str(), ok);
+        if (!ok) {
+            std::cerr << "Error: Cannot read the baseline " << options.baselinePath << "\n";
+            return 1;
+        }
+    }
+
+    std::printf("%-32s %11s %3s %11s %11s %11s %11s %14s  %s\n", "case", "grid", "thr", "median ms", "mean ms", "stddev ms", "min ms", "ns/item", "vs baseline");
+    std::vector<Result> results;
+    int regressions = 0;
+
+    for (const MicrobenchOptions::GridSize& grid : options.grids) {
+        for (const Case& benchCase : CASES) {
+            if (!options.filter.empty() && std::strstr(benchCase.name, options.filter.c_str()) == nullptr) { continue; }
+
+            size_t threadCounts = benchCase.threaded ? options.threads.size() : 1;
+            for (size_t t = 0; t < threadCounts; ++t) {
+                Result result;
+                result.benchCase = &benchCase;
+                result.setup = { grid.width, grid.height, benchCase.threaded ? options.threads[t] : 1 };
+
+                std::unique_ptr<Bench> bench(benchCase.create(result.setup));
+                std::vector<double> times;
+                for (int repetition = 0; repetition < options.warmup + options.repeat; ++repetition) {
+                    bench->prepare();
+                    Clock::time_point start = Clock::now();
+                    result.items = bench->run();
+                    double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                    if (repetition >= options.warmup) { times.push_back(milliseconds); }
+                }
+                summarize(times, result);
+                results.push_back(result);
+
+                char comparison[64] = "";
+                std::map<std::string, double>::const_iterator previous = baseline.find(result.getKey());
+                if (previous != baseline.end() && previous->second > 0.0) {
+                    double change = (result.medianMs / previous->second - 1.0) * 100.0;
+                    bool regressed = change > options.threshold;
+                    regressions += regressed;
+                    std::snprintf(comparison, sizeof(comparison), "%+.1f%%%s", change, regressed ? " REGRESSION" : "");
+                }
+                char gridText[32];
+                std::snprintf(gridText, sizeof(gridText), "%dx%d", grid.width, grid.height);
+                std::printf("%-32s %11s %3d %11.4f %11.4f %11.4f %11.4f %10.3f/%-4s %s\n", benchCase.name, gridText, result.setup.threads,
+                    result.medianMs, result.meanMs, result.stddevMs, result.minMs,
+                    (result.items > 0.0) ? result.medianMs * 1e6 / result.items : 0.0, benchCase.unit, comparison);
+                std::fflush(stdout);
+            }
+        }
+    }
+
+    if (!writeReport(options.outPath.c_str(), options, results)) {
+        std::cerr << "Error: Cannot write " << options.outPath << "\n";
+        return 1;
+    }
+    if (regressions > 0) {
+        std::printf("%d case(s) more than %.1f%% slower than %s\n", regressions, options.threshold, options.baselinePath.c_str());
+        return 1;
+    }
+    return 0;
+}
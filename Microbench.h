@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// `SandboxGL --microbench [options]`: times the simulation and render-prep hot paths in
+// isolation. Every case runs its warmup, then its timed repetitions, for each grid size (and
+// each thread count when the case uses the ThreadPool: the software renderer and the step and
+// scenario cases on the striped engine); results are printed as a table and written as JSON,
+// one result per line.
+//   --grid WxH[,WxH]    grid sizes (default SIMULATION_GRID_WIDTH x HEIGHT)
+//   --threads T[,T]     thread counts of the threaded cases (default 1)
+//   --filter TEXT       only cases whose name contains TEXT
+//   --warmup N          untimed repetitions first (default 3)
+//   --repeat N          timed repetitions (default 15)
+//   --out PATH          JSON results (default MICROBENCH_REPORT_PATH)
+//   --baseline PATH     earlier --out file; medians slower by more than the threshold fail the run
+//   --threshold PCT     allowed slowdown against the baseline (default 10)
+struct MicrobenchOptions {
+	struct GridSize { int width, height; };
+
+	std::vector<GridSize> grids;
+	std::vector<int> threads;
+	std::string filter;
+	int warmup = 3;
+	int repeat = 15;
+	std::string outPath;
+	std::string baselinePath;
+	double threshold = 10.0;
+
+	bool parse(int argc, char** argv);
+};
+
+int runMicrobench(int argc, char** argv);
@@ -1,8 +1,16 @@
 #include "SandboxGUI.h"
+#include "../MemoryTracker.h"
+#include "../Profiler.h"
+#include <cmath>
 
 SandboxGUI::SandboxGUI(GLFWwindow* window)
 {
     IMGUI_CHECKVERSION();
+    if (MemoryTracker::isEnabled()) {
+        ImGui::SetAllocatorFunctions(
+            [](size_t size, void*) { return MemoryTracker::allocate(size, MemoryTracker::TAG_GUI); },
+            [](void* memory, void*) { MemoryTracker::release(memory); });
+    }
     ImGui::CreateContext();
     io = &ImGui::GetIO();
     ImGui::StyleColorsDark();
@@ -17,25 +25,140 @@ void SandboxGUI::update()
     ImGui::NewFrame();
 }
 
-void SandboxGUI::addText(const std::string text)
+void SandboxGUI::addText(const char* text)
 {
-	ImGui::Text(text.c_str());
+	ImGui::TextUnformatted(text);
 }
 
-void SandboxGUI::addIntSlider(std::string sliderName, int &var, int min, int max)
+void SandboxGUI::addIntSlider(const char* sliderName, int &var, int min, int max)
 {
-    ImGui::SliderInt(sliderName.c_str(), &var, min, max);
+    ImGui::SliderInt(sliderName, &var, min, max);
 }
 
-void SandboxGUI::addFloatSlider(std::string sliderName, float& var, float min, float max)
+void SandboxGUI::addFloatSlider(const char* sliderName, float& var, float min, float max)
 {
-    ImGui::SliderFloat(sliderName.c_str(), &var, min, max);
+    ImGui::SliderFloat(sliderName, &var, min, max);
+}
+
+bool SandboxGUI::addCombo(const char* comboName, int& selected, const char* const items[], int itemCount)
+{
+    return ImGui::Combo(comboName, &selected, items, itemCount);
+}
+
+bool SandboxGUI::addButton(const char* label, bool sameLine)
+{
+    if (sameLine) { ImGui::SameLine(); }
+    return ImGui::Button(label);
+}
+
+static ImU32 zoneColor(int zone)
+{
+    return ImColor::HSV(std::fmod(zone * 0.618f, 1.0f), 0.55f, 0.9f);
+}
+
+void SandboxGUI::addProfilerGraph(float budgetMs)
+{
+    if (!ImGui::CollapsingHeader("Profiler", ImGuiTreeNodeFlags_DefaultOpen)) { return; }
+    int frames = Profiler::getHistoryCount();
+    if (frames == 0) { return; }
+
+    drawStackedGraph("CPU", false, budgetMs);
+    drawStackedGraph("GPU", true, budgetMs);
+
+    // The newest frame that went over budget and the zone that took most of it
+    for (int framesAgo = 0; framesAgo < frames; ++framesAgo) {
+        const Profiler::FrameTimes& times = Profiler::getFrameTimes(framesAgo);
+        if (times.frameMs <= budgetMs) { continue; }
+        int worst = 0;
+        for (int zone = 1; zone < Profiler::getZoneCount(); ++zone) {
+            if (times.stackMs[zone] > times.stackMs[worst]) { worst = zone; }
+        }
+        ImGui::Text("Over budget %d frames ago: %.2f ms, %s %.2f ms", framesAgo, times.frameMs,
+            Profiler::getZoneName(worst), times.stackMs[worst]);
+        break;
+    }
+
+    // Averages over the last second or so, a single frame is too noisy to read
+    const int averageFrames = frames < 60 ? frames : 60;
+    if (!ImGui::BeginTable("zones", 3, ImGuiTableFlags_SizingFixedFit)) { return; }
+    ImGui::TableSetupColumn("zone");
+    ImGui::TableSetupColumn("cpu ms");
+    ImGui::TableSetupColumn("gpu ms");
+    ImGui::TableHeadersRow();
+    for (int zone = 0; zone < Profiler::getZoneCount(); ++zone) {
+        float cpuMs = 0.0f, gpuMs = 0.0f;
+        int gpuFrames = 0;
+        for (int framesAgo = 0; framesAgo < averageFrames; ++framesAgo) {
+            const Profiler::FrameTimes& times = Profiler::getFrameTimes(framesAgo);
+            cpuMs += times.cpuMs[zone];
+            if (times.gpuMs[zone] >= 0.0f) { gpuMs += times.gpuMs[zone]; ++gpuFrames; }
+        }
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::ColorButton(Profiler::getZoneName(zone), ImColor(zoneColor(zone)), ImGuiColorEditFlags_NoTooltip,
+            ImVec2(ImGui::GetTextLineHeight(), ImGui::GetTextLineHeight()));
+        ImGui::SameLine();
+        ImGui::TextUnformatted(Profiler::getZoneName(zone));
+        ImGui::TableNextColumn();
+        ImGui::Text("%6.2f", cpuMs / averageFrames);
+        ImGui::TableNextColumn();
+        if (gpuFrames > 0) { ImGui::Text("%6.2f", gpuMs / gpuFrames); }
+    }
+    ImGui::EndTable();
+}
+
+void SandboxGUI::drawStackedGraph(const char* label, bool gpu, float budgetMs)
+{
+    // Twice the budget fits on the graph, taller frames are cut off with a red cap
+    const float height = 70.0f;
+    const float scaleMs = budgetMs * 2.0f;
+    float width = ImGui::GetContentRegionAvail().x;
+    if (width < 240.0f) { width = 240.0f; }
+
+    ImGui::TextUnformatted(label);
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::Dummy(ImVec2(width, height));
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + height), IM_COL32(20, 20, 20, 200));
+
+    float barWidth = width / Profiler::HISTORY_FRAMES;
+    float bottom = origin.y + height;
+    for (int framesAgo = 0; framesAgo < Profiler::getHistoryCount(); ++framesAgo) {
+        const Profiler::FrameTimes& times = Profiler::getFrameTimes(framesAgo);
+        float right = origin.x + width - framesAgo * barWidth;
+        float left = right - barWidth;
+        float stackedMs = 0.0f;
+
+        for (int zone = 0; zone < Profiler::getZoneCount(); ++zone) {
+            float ms = gpu ? times.gpuMs[zone] : times.stackMs[zone];
+            if (ms <= 0.0f) { continue; }
+            float y0 = bottom - std::fmin(stackedMs / scaleMs, 1.0f) * height;
+            stackedMs += ms;
+            float y1 = bottom - std::fmin(stackedMs / scaleMs, 1.0f) * height;
+            drawList->AddRectFilled(ImVec2(left, y1), ImVec2(right, y0), zoneColor(zone));
+        }
+
+        // Loop time outside every zone: waiting on vsync, event polling, HUD text
+        if (!gpu && times.frameMs > stackedMs) {
+            float y0 = bottom - std::fmin(stackedMs / scaleMs, 1.0f) * height;
+            float y1 = bottom - std::fmin(times.frameMs / scaleMs, 1.0f) * height;
+            drawList->AddRectFilled(ImVec2(left, y1), ImVec2(right, y0), IM_COL32(90, 90, 90, 255));
+            stackedMs = times.frameMs;
+        }
+        if (stackedMs > scaleMs) {
+            drawList->AddRectFilled(ImVec2(left, origin.y), ImVec2(right, origin.y + 2.0f), IM_COL32(255, 40, 40, 255));
+        }
+    }
+
+    float budgetY = bottom - budgetMs / scaleMs * height;
+    drawList->AddLine(ImVec2(origin.x, budgetY), ImVec2(origin.x + width, budgetY), IM_COL32(255, 255, 255, 160));
 }
 
 void SandboxGUI::render()
 {
     /*ImGui::Begin("Sandbox HUD");
     ImGui::End();*/
+    PROFILE_GPU_ZONE("gui");
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -14,10 +14,14 @@ public:
     void update();
     void render();
     void destroy();
-    void addText(const std::string textPtr);
-    void addIntSlider(std::string sliderName, int& var, int min, int max);
-    void addFloatSlider(std::string sliderName, float& var, float min, float max);
+    void addText(const char* text);
+    void addIntSlider(const char* sliderName, int& var, int min, int max);
+    void addFloatSlider(const char* sliderName, float& var, float min, float max);
+    bool addCombo(const char* comboName, int& selected, const char* const items[], int itemCount);
+    bool addButton(const char* label, bool sameLine = false); // True on the frame it was clicked
+    void addProfilerGraph(float budgetMs); // Stacked zone times of the last Profiler::HISTORY_FRAMES frames
 
 private:
+    void drawStackedGraph(const char* label, bool gpu, float budgetMs);
     std::vector<std::string> texts;
 };
\ No newline at end of file
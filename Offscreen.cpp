@@ -0,0 +1,168 @@
+#include "Offscreen.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include "Config.h"
+#include "FrameCapture.h"
+#include "Profiler.h"
+#include "PerfCounters.h"
+#include "Scenario.h"
+#include "Headless.h"
+#include "Renderer.h"
+#include "Camera.h"
+#include "ThreadPool.h"
+
+OffscreenTarget::OffscreenTarget(int width, int height)
+{
+    _width = width;
+    _height = height;
+
+    glGenRenderbuffers(1, &_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenFramebuffers(1, &_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Error: Offscreen framebuffer is incomplete\n";
+    }
+}
+
+OffscreenTarget::~OffscreenTarget()
+{
+    glDeleteFramebuffers(1, &_framebuffer);
+    glDeleteRenderbuffers(1, &_colorBuffer);
+}
+
+void OffscreenTarget::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glViewport(0, 0, _width, _height);
+}
+
+int runOffscreen(int argc, char** argv)
+{
+    HeadlessOptions options;
+    if (!options.parse(argc, argv)) { return 1; }
+
+    // The null platform has no windows to show, GLFW then creates the context through EGL
+    if (options.surfaceless) {
+        if (!glfwPlatformSupported(GLFW_PLATFORM_NULL)) {
+            std::cerr << "Error: This GLFW build has no null platform for --surfaceless\n";
+            return 1;
+        }
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+    if (!glfwInit()) {
+        std::cerr << "Error: Failed to initialize GLFW\n";
+        return 1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (options.surfaceless) { glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API); }
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Sandbox (offscreen)", NULL, NULL);
+    if (!window) {
+        std::cerr << "Error: Failed to create the offscreen context\n";
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Error: Failed to Initialize the GLAD\n";
+        glfwTerminate();
+        return 1;
+    }
+    // Keep stdout clean when the video stream goes there
+    FILE* report = (options.outPrefix == "-") ? stderr : stdout;
+    std::fprintf(report, "Offscreen: %s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+    int result = 0;
+    {
+        std::unique_ptr<ThreadPool> pool;
+        if (options.engine == Simulation::ENGINE_STRIPED) { pool.reset(new ThreadPool(options.threads)); }
+        Simulation sim(options.gridWidth, options.gridHeight);
+        sim.setEngine((Simulation::Engine)options.engine, pool.get());
+        Camera camera;
+        OffscreenTarget target(options.imageWidth, options.imageHeight);
+        target.bind();
+
+        Renderer renderer(&sim, &camera);
+        if (options.mode >= 0 && options.mode < Renderer::RENDER_MODE_COUNT) {
+            renderer.setMode((Renderer::RenderMode)options.mode);
+        }
+
+        FrameCapture capture(options.outPrefix.c_str(), options.imageWidth, options.imageHeight);
+        if (!capture.isOpen()) { result = 1; }
+
+        std::mt19937 rng(options.seed);
+        Scenario scenario((options.scenario >= 0) ? (Scenario::Id)options.scenario : Scenario::SCENARIO_RAIN, options.seed);
+        if (options.scenario >= 0) { scenario.setUp(sim); }
+        PerfCounters perf;
+        if (options.perfCounters) {
+            if (pool) { perf.addThreads(*pool); }
+            sim.setPerfCounters(&perf);
+        }
+        typedef std::chrono::steady_clock Clock;
+        double renderMs = 0.0;
+
+        for (int tick = 1; tick <= options.frames && result == 0; ++tick) {
+            if (!options.startTraceAt(tick)) {
+                result = 1;
+                break;
+            }
+            Profiler::beginFrame();
+            if (options.scenario >= 0) { scenario.update(sim); }
+            else { spawnHeadlessGrains(sim, rng, tick, options.frames); }
+            sim.step();
+
+            // glFinish keeps the timing to this frame's GL work
+            Clock::time_point start = Clock::now();
+            target.bind();
+            renderer.upload();
+            glClearColor(CLEAR_COLOR[0], CLEAR_COLOR[1], CLEAR_COLOR[2], CLEAR_COLOR[3]);
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderer.draw();
+            glFinish();
+            renderMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            if (options.isDumpTick(tick)) {
+                PROFILE_ZONE("capture");
+                capture.capture(tick);
+            }
+            PROFILE_COUNTER("instances", renderer.getInstanceCount());
+            PROFILE_COUNTER("uploaded bytes", renderer.getUploadedBytes());
+            Profiler::endFrame();
+        }
+        Profiler::stopTrace();
+        capture.finish();
+        if (capture.hasFailed()) {
+            std::cerr << "Error: Cannot write the captured frames to " << options.outPrefix << "\n";
+            result = 1;
+        }
+
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR) {
+            std::cerr << "Error: GL error 0x" << std::hex << error << std::dec << "\n";
+            result = 1;
+        }
+        std::fprintf(report, "Offscreen: %d frames of %s at %dx%d, %.3f ms/frame, %s simulation\n", options.frames,
+            Renderer::MODE_NAMES[renderer.getMode()], options.imageWidth, options.imageHeight, renderMs / std::max(1, options.frames),
+            Simulation::ENGINE_NAMES[options.engine]);
+        std::fprintf(report, "Capture: %d frames written, %.3f ms/frame on the render thread, %d stalls\n",
+            capture.getWrittenFrames(), capture.getAverageCaptureMs(), capture.getStalls());
+        if (options.perfCounters) { printPerfCounters(report, perf); }
+        if (options.scenario >= 0 && !reportScenario(report, scenario, sim)) { result = 1; }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return result;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Colour target for rendering without a default framebuffer
+class OffscreenTarget
+{
+public:
+	OffscreenTarget(int width, int height);
+	~OffscreenTarget();
+
+	void bind(); // Also sets the viewport
+	unsigned int getFramebuffer() { return _framebuffer; }
+	int getWidth() { return _width; }
+	int getHeight() { return _height; }
+
+private:
+	int _width, _height;
+	unsigned int _framebuffer, _colorBuffer;
+};
+
+// `SandboxGL --offscreen [options]` (options in Headless.h): the real GL renderer in a hidden
+// window, or with --surfaceless on GLFW's null platform over EGL (e.g. EGL_PLATFORM=surfaceless
+// with Mesa llvmpipe). Runs the seeded headless scene and prints GL timings. Frames go through
+// FrameCapture: PNGs named like --headless ones, or one Y4M stream for --out NAME.y4m or --out -.
+int runOffscreen(int argc, char** argv);
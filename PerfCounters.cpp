@@ -0,0 +1,166 @@
+#include "PerfCounters.h"
+#include <cstdio>
+#include "ThreadPool.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+const char* const PerfCounters::COUNTER_NAMES[COUNTER_COUNT] = {
+    "cycles", "instructions", "L1D misses", "LLC misses", "branch misses"
+};
+
+#ifdef __linux__
+namespace
+{
+    int openCounter(uint32_t type, uint64_t config, int groupFd)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = (groupFd < 0); // Members follow the leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+    }
+
+    uint64_t cacheMisses(uint64_t cache)
+    {
+        return cache | ((uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) | ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    // One group on the calling thread, so all of them count over exactly the same instructions
+    void openGroup(int* fds)
+    {
+        fds[PerfCounters::COUNTER_CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (fds[PerfCounters::COUNTER_CYCLES] < 0) { return; }
+        int leader = fds[PerfCounters::COUNTER_CYCLES];
+        fds[PerfCounters::COUNTER_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+        fds[PerfCounters::COUNTER_L1D_MISSES] = openCounter(PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_L1D), leader);
+        fds[PerfCounters::COUNTER_LLC_MISSES] = openCounter(PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_LL), leader);
+        fds[PerfCounters::COUNTER_BRANCH_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, leader);
+    }
+
+    void closeGroup(const int* fds)
+    {
+        // Members first, the leader holds the group
+        for (int counter = PerfCounters::COUNTER_COUNT - 1; counter >= 0; --counter) {
+            if (fds[counter] >= 0) { close(fds[counter]); }
+        }
+    }
+
+    // Adds what the group counted since it was enabled
+    void readGroup(const int* fds, uint64_t* values)
+    {
+        for (int counter = 0; counter < PerfCounters::COUNTER_COUNT; ++counter) {
+            if (fds[counter] < 0) { continue; }
+
+            // value, time enabled, time running: a group that shared the PMU with others is scaled up
+            uint64_t data[3];
+            if (read(fds[counter], data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0) { continue; }
+            values[counter] += (data[2] < data[1]) ? (uint64_t)((double)data[0] * data[1] / data[2]) : data[0];
+        }
+    }
+}
+#endif
+
+PerfCounters::PerfCounters()
+{
+    for (int& fd : _fds) { fd = -1; }
+#ifdef __linux__
+    openGroup(_fds);
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (const Group& group : _workerGroups) { closeGroup(group.fds); }
+    closeGroup(_fds);
+#endif
+}
+
+void PerfCounters::addThreads(ThreadPool& pool)
+{
+    if (!isAvailable()) { return; }
+#ifdef __linux__
+    // One item per thread, so each worker opens a group on itself; range 0 is the caller's
+    std::vector<Group> groups(pool.getThreadCount());
+    pool.parallelFor((int)groups.size(), [&groups](int begin, int end) {
+        for (int index = begin; index < end; ++index) {
+            for (int& fd : groups[index].fds) { fd = -1; }
+            if (index > 0) { openGroup(groups[index].fds); }
+        }
+    });
+    for (const Group& group : groups) {
+        if (group.fds[COUNTER_CYCLES] >= 0) { _workerGroups.push_back(group); }
+    }
+#endif
+}
+
+void PerfCounters::begin()
+{
+    if (!isAvailable()) { return; }
+#ifdef __linux__
+    for (const Group& group : _workerGroups) {
+        ioctl(group.fds[COUNTER_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(group.fds[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    ioctl(_fds[COUNTER_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_fds[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    _running = true;
+#endif
+}
+
+void PerfCounters::end()
+{
+    if (!_running) { return; }
+    _running = false;
+#ifdef __linux__
+    ioctl(_fds[COUNTER_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    for (const Group& group : _workerGroups) { ioctl(group.fds[COUNTER_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP); }
+
+    uint64_t values[COUNTER_COUNT] = {};
+    readGroup(_fds, values);
+    for (const Group& group : _workerGroups) { readGroup(group.fds, values); }
+
+    for (int counter = 0; counter < COUNTER_COUNT; ++counter) {
+        _totals.values[counter] += values[counter];
+        _window.values[counter] += values[counter];
+    }
+    _totals.samples++;
+    if (++_window.samples == RECENT_SAMPLES) {
+        _recent = _window;
+        _window = Totals();
+    }
+#endif
+}
+
+void PerfCounters::reset()
+{
+    _totals = Totals();
+    _window = Totals();
+    _recent = Totals();
+}
+
+void PerfCounters::format(const Totals& totals, char* text, int size)
+{
+    if (!isAvailable() || totals.samples == 0) {
+        if (size > 0) { text[0] = '\0'; }
+        return;
+    }
+
+    int length = std::snprintf(text, size, "IPC %.2f", totals.getIpc());
+    for (int counter = COUNTER_L1D_MISSES; counter < COUNTER_COUNT && length < size; ++counter) {
+        if (!isValid((Counter)counter)) { continue; }
+        length += std::snprintf(text + length, size - length, ", %s %.2f", COUNTER_NAMES[counter], totals.getMpki((Counter)counter));
+    }
+    if (length < size) { std::snprintf(text + length, size - length, " per 1k instructions"); }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Hardware counters (cycles, instructions, L1D and LLC read misses, branch mispredicts) of the
+// calling thread around a piece of code, through perf_event_open on Linux, plus the workers of
+// any pool added with addThreads(). User space only, so perf_event_paranoid up to 2 is enough. Elsewhere, or when the kernel refuses, isAvailable() is
+// false and begin/end do nothing. Counters the CPU can't count stay invalid on their own.
+class PerfCounters
+{
+public:
+	enum Counter {
+		COUNTER_CYCLES = 0,
+		COUNTER_INSTRUCTIONS,
+		COUNTER_L1D_MISSES,
+		COUNTER_LLC_MISSES,
+		COUNTER_BRANCH_MISSES,
+		COUNTER_COUNT
+	};
+	static const char* const COUNTER_NAMES[COUNTER_COUNT];
+	static const int RECENT_SAMPLES = 64; // Measurements per getRecent() window
+
+	// Counts summed over a number of measurements
+	struct Totals
+	{
+		uint64_t values[COUNTER_COUNT] = {};
+		int samples = 0;
+
+		double getIpc() const { return values[COUNTER_CYCLES] ? (double)values[COUNTER_INSTRUCTIONS] / values[COUNTER_CYCLES] : 0.0; }
+		double getPerSample(Counter counter) const { return samples ? (double)values[counter] / samples : 0.0; }
+		// Events per thousand instructions
+		double getMpki(Counter counter) const { return values[COUNTER_INSTRUCTIONS] ? values[counter] * 1000.0 / values[COUNTER_INSTRUCTIONS] : 0.0; }
+	};
+
+	PerfCounters();
+	~PerfCounters();
+
+	bool isAvailable() { return _fds[COUNTER_CYCLES] >= 0; }
+	bool isValid(Counter counter) { return _fds[counter] >= 0; }
+
+	// Counts the pool's workers too, summed with the calling thread. Call it once per pool, from the
+	// thread that made the counters and runs the pool's parallelFor calls (its range is counted already).
+	void addThreads(ThreadPool& pool);
+
+	void begin();
+	void end();
+	void reset();
+
+	const Totals& getTotals() { return _totals; } // Since the last reset
+	const Totals& getRecent() { return _recent; } // Last full window of RECENT_SAMPLES measurements
+
+	// One line of IPC and misses per kilo-instruction, empty when nothing was counted
+	void format(const Totals& totals, char* text, int size);
+
+private:
+	struct Group
+	{
+		int fds[COUNTER_COUNT];
+	};
+
+	int _fds[COUNTER_COUNT]; // The calling thread's group
+	std::vector<Group> _workerGroups;
+	Totals _totals, _window, _recent;
+	bool _running = false;
+};
@@ -0,0 +1,329 @@
+#include "Profiler.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    const std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+
+    // Hands the buffer back when its thread exits, so short-lived threads don't pile up buffers
+    struct ThreadSlot
+    {
+        std::atomic<bool>* owned = nullptr;
+        void* buffer = nullptr;
+        ~ThreadSlot() { if (owned != nullptr) { owned->store(false, std::memory_order_release); } }
+    };
+    thread_local ThreadSlot threadSlot;
+    thread_local int cpuDepth = 0;
+
+    uint32_t gpuFrames[Profiler::GPU_FRAMES]; // Frame each query slot was filled in
+    bool running = false; // beginFrame was called, GPU zones only work inside frames
+
+    const int GPU_LANE = 0; // Trace lane of the GPU zones, thread lanes start at 1
+}
+
+const char* Profiler::_zoneNames[MAX_ZONES];
+int Profiler::_zoneCount = 0;
+std::mutex Profiler::_mutex;
+std::vector<Profiler::ThreadBuffer*> Profiler::_threads;
+std::atomic<uint32_t> Profiler::_frame(0);
+uint64_t Profiler::_frameBegin = 0;
+Profiler::FrameTimes Profiler::_history[HISTORY_FRAMES];
+int Profiler::_historyCount = 0;
+Profiler::GpuQuery Profiler::_gpuQueries[GPU_FRAMES][GPU_ZONES_PER_FRAME];
+int Profiler::_gpuQueryCount[GPU_FRAMES];
+bool Profiler::_gpuActive = false;
+bool Profiler::_gpuReady = false;
+const char* Profiler::_counterNames[MAX_COUNTERS];
+double Profiler::_counterValues[MAX_COUNTERS];
+int Profiler::_counterCount = 0;
+uint32_t Profiler::_countersSet = 0;
+FILE* Profiler::_traceFile = nullptr;
+uint32_t Profiler::_traceBegin = 0;
+uint32_t Profiler::_traceEnd = 0;
+
+bool Profiler::isEnabled()
+{
+#ifdef SANDBOX_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t Profiler::now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+int Profiler::registerZone(const char* name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int zone = 0; zone < _zoneCount; ++zone) {
+        if (std::strcmp(_zoneNames[zone], name) == 0) { return zone; }
+    }
+    if (_zoneCount == MAX_ZONES) { return MAX_ZONES - 1; } // Shares the last zone rather than failing
+    _zoneNames[_zoneCount] = name;
+    return _zoneCount++;
+}
+
+int Profiler::registerCounter(const char* name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int counter = 0; counter < _counterCount; ++counter) {
+        if (std::strcmp(_counterNames[counter], name) == 0) { return counter; }
+    }
+    if (_counterCount == MAX_COUNTERS) { return MAX_COUNTERS - 1; }
+    _counterNames[_counterCount] = name;
+    return _counterCount++;
+}
+
+void Profiler::setCounter(int counter, double value)
+{
+    _counterValues[counter] = value;
+    _countersSet |= 1u << counter;
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(_mutex); // stopTrace reads the names
+    std::snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+Profiler::ThreadBuffer* Profiler::getThreadBuffer()
+{
+    if (threadSlot.buffer != nullptr) { return static_cast<ThreadBuffer*>(threadSlot.buffer); }
+
+    // First zone on this thread: take over a buffer a finished thread left, or add one
+    std::lock_guard<std::mutex> lock(_mutex);
+    ThreadBuffer* buffer = nullptr;
+    for (size_t i = 0; i < _threads.size() && buffer == nullptr; ++i) {
+        bool expected = false;
+        if (_threads[i]->owned.compare_exchange_strong(expected, true)) { buffer = _threads[i]; }
+    }
+    if (buffer == nullptr) {
+        buffer = new ThreadBuffer();
+        _threads.push_back(buffer);
+    }
+    buffer->isMain = false;
+    buffer->name[0] = '\0';
+    threadSlot.owned = &buffer->owned;
+    threadSlot.buffer = buffer;
+    return buffer;
+}
+
+void Profiler::record(int zone, uint64_t begin, uint64_t end)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    Event& event = buffer->events[head & (RING_EVENTS - 1)];
+    event.begin = begin;
+    event.end = end;
+    event.frame = _frame.load(std::memory_order_relaxed);
+    event.zone = (int16_t)zone;
+    event.depth = (int16_t)cpuDepth;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+Profiler::CpuZone::CpuZone(int zone)
+{
+    _zone = zone;
+    ++cpuDepth;
+    _begin = now();
+}
+
+Profiler::CpuZone::~CpuZone()
+{
+    uint64_t end = now();
+    --cpuDepth;
+    record(_zone, _begin, end);
+}
+
+Profiler::GpuZone::GpuZone(int zone)
+{
+    int slot = getFrame() % GPU_FRAMES;
+    _active = running && _gpuReady && !_gpuActive && _gpuQueryCount[slot] < GPU_ZONES_PER_FRAME;
+    if (!_active) { return; }
+
+    GpuQuery& query = _gpuQueries[slot][_gpuQueryCount[slot]++];
+    query.zone = zone;
+    query.cpuBegin = now();
+    glBeginQuery(GL_TIME_ELAPSED, query.query);
+    _gpuActive = true;
+}
+
+Profiler::GpuZone::~GpuZone()
+{
+    if (!_active) { return; }
+    glEndQuery(GL_TIME_ELAPSED);
+    _gpuActive = false;
+}
+
+void Profiler::beginFrame()
+{
+    if (!running) {
+        running = true;
+        ThreadBuffer* main = getThreadBuffer();
+        main->isMain = true;
+        if (main->name[0] == '\0') { std::snprintf(main->name, sizeof(main->name), "main"); }
+
+        // Timer queries are core since 3.3
+        _gpuReady = GLAD_GL_VERSION_3_3 != 0;
+        for (int slot = 0; _gpuReady && slot < GPU_FRAMES; ++slot) {
+            for (GpuQuery& query : _gpuQueries[slot]) { glGenQueries(1, &query.query); }
+        }
+    }
+
+    _frameBegin = now();
+    uint32_t frame = getFrame();
+    FrameTimes& times = historyFor(frame);
+    for (int zone = 0; zone < MAX_ZONES; ++zone) {
+        times.cpuMs[zone] = 0.0f;
+        times.stackMs[zone] = 0.0f;
+        times.gpuMs[zone] = -1.0f;
+    }
+    times.frameMs = 0.0f;
+
+    if (_gpuReady) {
+        collectGpu(false);
+        // Queries the GPU hasn't answered after GPU_FRAMES frames are dropped with the slot
+        int slot = frame % GPU_FRAMES;
+        _gpuQueryCount[slot] = 0;
+        gpuFrames[slot] = frame;
+    }
+}
+
+// Without wait only the queries the GPU has answered, with wait every pending one
+void Profiler::collectGpu(bool wait)
+{
+    for (int slot = 0; slot < GPU_FRAMES; ++slot) {
+        FrameTimes& times = historyFor(gpuFrames[slot]);
+
+        // Queries finish in order, so stop at the first one still pending
+        int collected = 0;
+        for (; collected < _gpuQueryCount[slot]; ++collected) {
+            GpuQuery& query = _gpuQueries[slot][collected];
+            if (!wait) {
+                GLint available = 0;
+                glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) { break; }
+            }
+
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &nanoseconds);
+            float& gpuMs = times.gpuMs[query.zone];
+            gpuMs = (gpuMs < 0.0f ? 0.0f : gpuMs) + (float)(nanoseconds * 1e-6);
+            if (_traceFile != nullptr && gpuFrames[slot] >= _traceBegin) {
+                writeTraceEvent(_zoneNames[query.zone], GPU_LANE, query.cpuBegin, query.cpuBegin + nanoseconds, gpuFrames[slot]);
+            }
+        }
+
+        // Pending queries move to the front, the read ones behind them keep their query objects
+        std::rotate(_gpuQueries[slot], _gpuQueries[slot] + collected, _gpuQueries[slot] + _gpuQueryCount[slot]);
+        _gpuQueryCount[slot] -= collected;
+    }
+}
+
+void Profiler::endFrame()
+{
+    uint32_t frame = getFrame();
+    uint64_t frameEnd = now();
+    FrameTimes& current = historyFor(frame);
+    current.frameMs = (float)((frameEnd - _frameBegin) * 1e-6);
+
+    {
+        // Drain every thread's ring into the frames its events belong to
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t lane = 0; lane < _threads.size(); ++lane) {
+            ThreadBuffer* buffer = _threads[lane];
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            if (head - buffer->tail > (uint64_t)RING_EVENTS) { buffer->tail = head - RING_EVENTS; } // Overrun, the oldest are gone
+
+            for (; buffer->tail < head; ++buffer->tail) {
+                Event event = buffer->events[buffer->tail & (RING_EVENTS - 1)];
+                // The writer may have lapped the reader while the event was copied
+                if (buffer->head.load(std::memory_order_acquire) - buffer->tail > (uint64_t)RING_EVENTS) { continue; }
+                if (frame - event.frame >= (uint32_t)HISTORY_FRAMES) { continue; }
+
+                FrameTimes& times = historyFor(event.frame);
+                float milliseconds = (float)((event.end - event.begin) * 1e-6);
+                times.cpuMs[event.zone] += milliseconds;
+                if (buffer->isMain && event.depth == 0) { times.stackMs[event.zone] += milliseconds; }
+
+                if (_traceFile != nullptr && event.frame >= _traceBegin) {
+                    writeTraceEvent(_zoneNames[event.zone], (int)lane + 1, event.begin, event.end, event.frame);
+                }
+            }
+            if (_traceFile != nullptr && buffer->isMain) { writeTraceEvent("frame", (int)lane + 1, _frameBegin, frameEnd, frame); }
+        }
+    }
+
+    if (_traceFile != nullptr) {
+        for (int counter = 0; counter < _counterCount; ++counter) {
+            if ((_countersSet & (1u << counter)) == 0) { continue; }
+            std::fprintf(_traceFile, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"value\":%.17g}}",
+                _counterNames[counter], frameEnd * 1e-3, _counterValues[counter]);
+        }
+        if (_traceEnd != 0 && frame + 1 >= _traceEnd) { stopTrace(); }
+    }
+    _countersSet = 0;
+
+    _frame.store(frame + 1, std::memory_order_relaxed);
+    if (_historyCount < HISTORY_FRAMES) { ++_historyCount; }
+}
+
+bool Profiler::startTrace(const char* path, uint32_t frames)
+{
+    if (!isEnabled()) { return false; }
+    stopTrace();
+
+    _traceFile = std::fopen(path, "w");
+    if (_traceFile == nullptr) { return false; }
+    std::fprintf(_traceFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(_traceFile, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"SandboxGL\"}}");
+    _traceBegin = getFrame();
+    _traceEnd = (frames > 0) ? _traceBegin + frames : 0;
+    return true;
+}
+
+void Profiler::stopTrace()
+{
+    if (_traceFile == nullptr) { return; }
+
+    // The last GPU_FRAMES frames' queries are still pending, without them the GPU lane ends early
+    if (_gpuReady) { collectGpu(true); }
+
+    // Lane names last, the viewers don't mind the order
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::fprintf(_traceFile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU (starts at CPU submit)\"}}", GPU_LANE);
+    for (size_t lane = 0; lane < _threads.size(); ++lane) {
+        const char* name = _threads[lane]->name;
+        char fallback[32];
+        if (name[0] == '\0') {
+            std::snprintf(fallback, sizeof(fallback), "thread %d", (int)lane + 1);
+            name = fallback;
+        }
+        std::fprintf(_traceFile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", (int)lane + 1, name);
+        std::fprintf(_traceFile, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+            (int)lane + 1, _threads[lane]->isMain ? -1 : (int)lane + 1);
+    }
+    std::fprintf(_traceFile, "\n]}\n");
+    std::fclose(_traceFile);
+    _traceFile = nullptr;
+}
+
+void Profiler::writeTraceEvent(const char* name, int lane, uint64_t begin, uint64_t end, uint32_t frame)
+{
+    // Complete events in microseconds
+    std::fprintf(_traceFile, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%u}}",
+        name, begin * 1e-3, (end - begin) * 1e-3, lane, frame);
+}
+
+const Profiler::FrameTimes& Profiler::getFrameTimes(int framesAgo)
+{
+    return historyFor(getFrame() - 1 - framesAgo);
+}
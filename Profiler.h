@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// Debug builds record zones, release builds only with SANDBOX_PROFILE defined, either one sets
+// SANDBOX_PROFILING here. Without it the PROFILE_* macros expand to nothing and the frame history stays empty.
+#if (defined(_DEBUG) || defined(SANDBOX_PROFILE)) && !defined(SANDBOX_PROFILING)
+#define SANDBOX_PROFILING
+#endif
+
+// Scoped timing zones. CPU zones land in a ring buffer owned by the recording thread (the owner
+// is the only writer, the main thread drains it at endFrame without locks), GPU zones wrap
+// GL_TIME_ELAPSED queries whose results are collected a few frames later without stalling.
+// Per-frame totals for the last HISTORY_FRAMES frames feed the HUD timeline, and a trace writes
+// every event of a range of frames as Chrome Trace Event JSON (chrome://tracing, ui.perfetto.dev).
+//
+//   PROFILE_ZONE("name");             CPU time of the enclosing scope, any thread
+//   PROFILE_GPU_ZONE("name");         CPU and GPU time of the scope, GL thread only, GPU zones don't nest
+//   PROFILE_COUNTER("name", value);   value track in the trace, main thread only
+//   PROFILE_THREAD("name");           names the calling thread's lane in the trace
+class Profiler
+{
+public:
+	static const int MAX_ZONES = 32;
+	static const int MAX_COUNTERS = 8;
+	static const int HISTORY_FRAMES = 240;
+	static const int RING_EVENTS = 4096; // Per thread, a power of two
+	static const int GPU_FRAMES = 4; // Frames a GPU query gets before its result is read
+	static const int GPU_ZONES_PER_FRAME = 16;
+
+	struct Event
+	{
+		uint64_t begin, end; // Nanoseconds since the profiler started
+		uint32_t frame;
+		int16_t zone;
+		int16_t depth; // Nesting on the recording thread, 0 for outermost
+	};
+
+	struct FrameTimes
+	{
+		float cpuMs[MAX_ZONES]; // Every thread and depth
+		float stackMs[MAX_ZONES]; // Outermost zones of the main thread only, so they can be stacked
+		float gpuMs[MAX_ZONES]; // Negative until the query result arrived
+		float frameMs;
+	};
+
+	class CpuZone
+	{
+	public:
+		CpuZone(int zone);
+		~CpuZone();
+	private:
+		uint64_t _begin;
+		int _zone;
+	};
+
+	class GpuZone
+	{
+	public:
+		GpuZone(int zone);
+		~GpuZone();
+	private:
+		bool _active;
+	};
+
+	static bool isEnabled();
+
+	static int registerZone(const char* name); // Same index for the same name
+	static int getZoneCount() { return _zoneCount; }
+	static const char* getZoneName(int zone) { return _zoneNames[zone]; }
+	static int registerCounter(const char* name);
+	static void setCounter(int counter, double value);
+	static void setThreadName(const char* name);
+
+	// Main thread, around everything it profiles
+	static void beginFrame();
+	static void endFrame();
+	static uint32_t getFrame() { return _frame.load(std::memory_order_relaxed); }
+	static uint64_t now(); // Profiler clock, nanoseconds
+
+	// framesAgo 0 is the last finished frame
+	static const FrameTimes& getFrameTimes(int framesAgo);
+	static int getHistoryCount() { return _historyCount; }
+
+	// Traces the current frame and the next ones, frames 0 traces until stopTrace, which waits for
+	// the GPU zones still in flight. Both need the GL context when GPU zones were recorded.
+	static bool startTrace(const char* path, uint32_t frames);
+	static void stopTrace();
+	static bool isTracing() { return _traceFile != nullptr; }
+
+private:
+	struct ThreadBuffer
+	{
+		Event events[RING_EVENTS];
+		std::atomic<uint64_t> head{ 0 }; // Events ever written, the owner publishes with release
+		std::atomic<bool> owned{ true }; // False once the thread exits, the next new thread takes the buffer over
+		uint64_t tail = 0; // Events the main thread has read
+		bool isMain = false;
+		char name[32] = {}; // Trace lane, empty for "thread N"
+	};
+
+	struct GpuQuery
+	{
+		unsigned int query;
+		int zone;
+		uint64_t cpuBegin; // Stands in for the GPU start in traces, GL_TIME_ELAPSED only measures a duration
+	};
+
+	static const char* _zoneNames[MAX_ZONES];
+	static int _zoneCount;
+	static std::mutex _mutex; // Zone registration and the thread list, never taken while recording
+	static std::vector<ThreadBuffer*> _threads;
+	static std::atomic<uint32_t> _frame; // Read by recording threads to tag their events
+	static uint64_t _frameBegin;
+
+	static const char* _counterNames[MAX_COUNTERS];
+	static double _counterValues[MAX_COUNTERS];
+	static int _counterCount;
+	static uint32_t _countersSet; // Bit per counter set this frame
+
+	static FrameTimes _history[HISTORY_FRAMES];
+	static int _historyCount;
+
+	static GpuQuery _gpuQueries[GPU_FRAMES][GPU_ZONES_PER_FRAME];
+	static int _gpuQueryCount[GPU_FRAMES];
+	static bool _gpuActive;
+	static bool _gpuReady;
+
+	static FILE* _traceFile;
+	static uint32_t _traceBegin, _traceEnd; // Frames, _traceEnd 0 for open-ended
+
+	static ThreadBuffer* getThreadBuffer();
+	static void record(int zone, uint64_t begin, uint64_t end);
+	static void collectGpu(bool wait);
+	static void writeTraceEvent(const char* name, int lane, uint64_t begin, uint64_t end, uint32_t frame);
+	static FrameTimes& historyFor(uint32_t frame) { return _history[frame % HISTORY_FRAMES]; }
+};
+
+#ifdef SANDBOX_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) \
+	static const int PROFILE_CONCAT(profileZoneId, __LINE__) = Profiler::registerZone(name); \
+	Profiler::CpuZone PROFILE_CONCAT(profileZone, __LINE__)(PROFILE_CONCAT(profileZoneId, __LINE__))
+#define PROFILE_GPU_ZONE(name) \
+	PROFILE_ZONE(name); \
+	Profiler::GpuZone PROFILE_CONCAT(profileGpuZone, __LINE__)(PROFILE_CONCAT(profileZoneId, __LINE__))
+#define PROFILE_COUNTER(name, value) do { \
+	static const int profileCounterId = Profiler::registerCounter(name); \
+	Profiler::setCounter(profileCounterId, (double)(value)); \
+} while (0)
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
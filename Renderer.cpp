@@ -0,0 +1,589 @@
+#include "Renderer.h"
+#include "Config.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+const char* const Renderer::MODE_NAMES[RENDER_MODE_COUNT] = { "Instanced quads", "Grid texture", "Incremental quads", "Packed quads", "Merged runs", "Point sprites" };
+
+static const float unitQuad[] = {
+    -0.5f,  0.5f, 0.0f,  // Top Left
+	-0.5f, -0.5f, 0.0f,  // Bottom Left 
+     0.5f, -0.5f, 0.0f,  // Bottom Right
+
+    -0.5f,  0.5f, 0.0f,  // Top Left
+     0.5f,  0.5f, 0.0f,  // Top Right
+	 0.5f, -0.5f, 0.0f   // Bottom Right
+};
+
+// Uploaded in place of sleeping chunks
+static const Simulation::TileType emptyChunk[SIMULATION_CHUNK_SIZE * SIMULATION_CHUNK_SIZE] = {};
+
+// Majority of the non-empty tiles in a 2x2 block, empty unless at least half of it is filled
+static Simulation::TileType downsample(Simulation::TileType a, Simulation::TileType b, Simulation::TileType c, Simulation::TileType d)
+{
+    const Simulation::TileType tiles[4] = { a, b, c, d };
+    Simulation::TileType best = Simulation::TILE_EMPTY;
+    int bestCount = 0, filled = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        if (tiles[i] == Simulation::TILE_EMPTY) { continue; }
+        ++filled;
+        int count = 0;
+        for (int j = 0; j < 4; ++j) { count += (tiles[j] == tiles[i]); }
+        if (count > bestCount) { best = tiles[i]; bestCount = count; }
+    }
+    return filled >= 2 ? best : Simulation::TILE_EMPTY;
+}
+
+Renderer::Renderer(Simulation* sim, Camera* camera)
+{
+    _sim = sim;
+    _camera = camera;
+    _visibleChunks = _instanceChunks = sim->getAllChunks();
+    createPalette();
+    createInstancedQuads();
+    createIncrementalQuads();
+    createPackedQuads();
+    createMergedRuns();
+    createPointSprites();
+    createGridTexture();
+    setMode(_mode);
+}
+
+void Renderer::setMode(RenderMode mode)
+{
+    _mode = mode;
+    _instancesValid = false;
+
+    // The change list is only worth recording while something consumes it
+    _sim->setChangeTracking(mode == RENDER_INCREMENTAL_QUADS);
+}
+
+void Renderer::upload()
+{
+    PROFILE_GPU_ZONE("upload");
+    _uploadedBytes = 0;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    _viewportWidth = viewport[2];
+    _viewportHeight = viewport[3];
+    _visibleChunks = getVisibleChunks();
+
+    // Once a cell is smaller than a pixel, draw the coarsest pyramid level that keeps it at least one
+    float cellPixels = _sim->getCellSize() * _camera->getZoom() * 0.5f * _viewportWidth;
+    _lod = 0;
+    while (cellPixels < 1.0f && _lod < _lodLevels) {
+        cellPixels *= 2.0f;
+        ++_lod;
+    }
+    if (_lod > 0) {
+        uploadLodLevels();
+        return;
+    }
+
+    switch (_mode)
+    {
+    case RENDER_INSTANCED_QUADS: uploadInstancedQuads(); break;
+    case RENDER_GRID_TEXTURE: uploadGridTexture(); break;
+    case RENDER_INCREMENTAL_QUADS: uploadIncrementalQuads(); break;
+    case RENDER_PACKED_QUADS:
+    case RENDER_POINT_SPRITES: uploadPackedQuads(); break;
+    case RENDER_MERGED_RUNS: uploadMergedRuns(); break;
+    default: break;
+    }
+}
+
+void Renderer::draw()
+{
+    PROFILE_GPU_ZONE("draw");
+    RenderMode mode = (_lod > 0) ? RENDER_GRID_TEXTURE : _mode;
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, _paletteTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    switch (mode)
+    {
+    case RENDER_INSTANCED_QUADS:
+        _quadShader->use();
+        applyCamera(_quadShader);
+        glUniform1i(_packedLocation, 0);
+        glUniform1i(_runsLocation, 0);
+        glBindVertexArray(_quadVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, _instanceCount);
+        _instanceStream->markInUse();
+        break;
+
+    case RENDER_INCREMENTAL_QUADS:
+        _quadShader->use();
+        applyCamera(_quadShader);
+        glUniform1i(_packedLocation, 0);
+        glUniform1i(_runsLocation, 0);
+        glBindVertexArray(_slotVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, _instanceCount);
+        break;
+
+    case RENDER_PACKED_QUADS:
+        _quadShader->use();
+        applyCamera(_quadShader);
+        glUniform1i(_packedLocation, 1);
+        glUniform1i(_runsLocation, 0);
+        glBindVertexArray(_packedVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, _instanceCount);
+        _packedStream->markInUse();
+        break;
+
+    case RENDER_MERGED_RUNS:
+        _quadShader->use();
+        applyCamera(_quadShader);
+        glUniform1i(_packedLocation, 1);
+        glUniform1i(_runsLocation, 1);
+        glBindVertexArray(_runVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, _instanceCount);
+        _runStream->markInUse();
+        break;
+
+    case RENDER_POINT_SPRITES:
+        _pointShader->use();
+        applyCamera(_pointShader);
+        glUniform2f(_viewportSizeLocation, (float)_viewportWidth, (float)_viewportHeight);
+        glBindVertexArray(_pointVAO);
+        glDrawArrays(GL_POINTS, 0, _instanceCount);
+        _packedStream->markInUse();
+        break;
+
+    case RENDER_GRID_TEXTURE:
+        _gridShader->use();
+        applyCamera(_gridShader);
+        glUniform1i(_gridShader->getUniformLocation("uLod"), _lod);
+        glBindVertexArray(_gridVAO);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, _gridTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        break;
+
+    default: break;
+    }
+}
+
+void Renderer::createPalette()
+{
+    uint8_t palette[Simulation::MAX_MATERIALS * 4];
+    Simulation::buildPalette(palette);
+
+    glGenTextures(1, &_paletteTexture);
+    glBindTexture(GL_TEXTURE_2D, _paletteTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Simulation::MAX_MATERIALS, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, palette);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+}
+
+void Renderer::createInstancedQuads()
+{
+    _quadShader = new Shader();
+    _quadShader->attachShader("./Shaders/shadervs.glsl", GL_VERTEX_SHADER);
+    _quadShader->attachShader("./Shaders/shaderfs.glsl", GL_FRAGMENT_SHADER);
+    _quadShader->attachShader("./Shaders/palettefs.glsl", GL_FRAGMENT_SHADER);
+    _quadShader->link();
+
+    _quadShader->use();
+    glUniform1f(_quadShader->getUniformLocation("uCellSize"), _sim->getCellSize());
+    glUniform1i(_quadShader->getUniformLocation("uPalette"), 1);
+    _packedLocation = _quadShader->getUniformLocation("uPacked");
+    _runsLocation = _quadShader->getUniformLocation("uRuns");
+
+    glGenVertexArrays(1, &_quadVAO);
+    glBindVertexArray(_quadVAO);
+
+    glGenBuffers(1, &_quadVBO);
+
+    // quadVBO
+    glBindBuffer(GL_ARRAY_BUFFER, _quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(unitQuad), unitQuad, GL_STATIC_DRAW);
+
+    size_t cellCount = _sim->getWidth() * _sim->getHeight();
+    _typesOffset = cellCount * sizeof(glm::vec2);
+    _instanceStream = new StreamingBuffer(GL_ARRAY_BUFFER, _typesOffset + cellCount * sizeof(Simulation::TileType));
+
+    bindQuadAttributes(_instanceStream->getBuffer(), _instanceStream->getBuffer());
+}
+
+void Renderer::createIncrementalQuads()
+{
+    _slots = new InstanceSlots(_sim);
+
+    glGenVertexArrays(1, &_slotVAO);
+    glBindVertexArray(_slotVAO);
+
+    // Sized for a full grid once, after that only glBufferSubData touches them
+    size_t cellCount = _sim->getWidth() * _sim->getHeight();
+    glGenBuffers(1, &_slotPositionVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, _slotPositionVBO);
+    glBufferData(GL_ARRAY_BUFFER, cellCount * sizeof(glm::vec2), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &_slotTypeVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, _slotTypeVBO);
+    glBufferData(GL_ARRAY_BUFFER, cellCount * sizeof(Simulation::TileType), nullptr, GL_DYNAMIC_DRAW);
+
+    bindQuadAttributes(_slotPositionVBO, _slotTypeVBO);
+}
+
+void Renderer::createPackedQuads()
+{
+    // Packed coordinates have 13 bits per axis
+    assert(_sim->getWidth() <= (1 << Simulation::PACKED_COORD_BITS) && _sim->getHeight() <= (1 << Simulation::PACKED_COORD_BITS));
+
+    glGenVertexArrays(1, &_packedVAO);
+    glBindVertexArray(_packedVAO);
+
+    _packedStream = new StreamingBuffer(GL_ARRAY_BUFFER, _sim->getWidth() * _sim->getHeight() * sizeof(uint32_t));
+
+    // quadVBO
+    glBindBuffer(GL_ARRAY_BUFFER, _quadVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 0);
+
+    // packed instances, offset is updated after every rebuild
+    glBindBuffer(GL_ARRAY_BUFFER, _packedStream->getBuffer());
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+}
+
+void Renderer::createMergedRuns()
+{
+    glGenVertexArrays(1, &_runVAO);
+    glBindVertexArray(_runVAO);
+
+    // Worst case is a run per cell, two uint32 each
+    _runStream = new StreamingBuffer(GL_ARRAY_BUFFER, _sim->getWidth() * _sim->getHeight() * 2 * sizeof(uint32_t));
+
+    // quadVBO
+    glBindBuffer(GL_ARRAY_BUFFER, _quadVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 0);
+
+    // packed start cell and run length, offsets are updated after every rebuild
+    glBindBuffer(GL_ARRAY_BUFFER, _runStream->getBuffer());
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, 2 * sizeof(uint32_t), (void*)0);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, 2 * sizeof(uint32_t), (void*)sizeof(uint32_t));
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
+}
+
+void Renderer::createPointSprites()
+{
+    _pointShader = new Shader();
+    _pointShader->attachShader("./Shaders/pointvs.glsl", GL_VERTEX_SHADER);
+    _pointShader->attachShader("./Shaders/shaderfs.glsl", GL_FRAGMENT_SHADER);
+    _pointShader->attachShader("./Shaders/palettefs.glsl", GL_FRAGMENT_SHADER);
+    _pointShader->link();
+
+    _pointShader->use();
+    glUniform1f(_pointShader->getUniformLocation("uCellSize"), _sim->getCellSize());
+    glUniform1i(_pointShader->getUniformLocation("uPalette"), 1);
+    _viewportSizeLocation = _pointShader->getUniformLocation("uViewportSize");
+
+    // Point size comes from the vertex shader
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    glGenVertexArrays(1, &_pointVAO);
+    glBindVertexArray(_pointVAO);
+
+    // packed cells, one vertex each, offset is updated after every rebuild
+    glBindBuffer(GL_ARRAY_BUFFER, _packedStream->getBuffer());
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+    glEnableVertexAttribArray(3);
+}
+
+void Renderer::bindQuadAttributes(unsigned int positionVBO, unsigned int typeVBO)
+{
+    // quadVBO
+    glBindBuffer(GL_ARRAY_BUFFER, _quadVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 0);
+
+    // instancePositionVBO
+    glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+
+    // tileTypeVBO
+    glBindBuffer(GL_ARRAY_BUFFER, typeVBO);
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_BYTE, sizeof(Simulation::TileType), (void*)0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+}
+
+void Renderer::createGridTexture()
+{
+    _gridShader = new Shader();
+    _gridShader->attachShader("./Shaders/gridvs.glsl", GL_VERTEX_SHADER);
+    _gridShader->attachShader("./Shaders/gridfs.glsl", GL_FRAGMENT_SHADER);
+    _gridShader->attachShader("./Shaders/palettefs.glsl", GL_FRAGMENT_SHADER);
+    _gridShader->link();
+
+    _gridShader->use();
+    glUniform1i(_gridShader->getUniformLocation("uGrid"), 0);
+    glUniform1f(_gridShader->getUniformLocation("uCellSize"), _sim->getCellSize());
+    glUniform1i(_gridShader->getUniformLocation("uPalette"), 1);
+    glUniform2i(_gridShader->getUniformLocation("uGridSize"), _sim->getWidth(), _sim->getHeight());
+
+    // The fullscreen triangle is generated from gl_VertexID, core profile still wants a VAO bound
+    glGenVertexArrays(1, &_gridVAO);
+
+    glGenTextures(1, &_gridTexture);
+    glBindTexture(GL_TEXTURE_2D, _gridTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, _sim->getWidth(), _sim->getHeight(), 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+
+    // Pyramid levels, at most one per halving of a chunk
+    _lodLevels = 0;
+    while (_lodLevels < SIMULATION_CHUNK_SHIFT && (_sim->getWidth() >> (_lodLevels + 1)) > 0 && (_sim->getHeight() >> (_lodLevels + 1)) > 0) {
+        ++_lodLevels;
+        glTexImage2D(GL_TEXTURE_2D, _lodLevels, GL_R8UI, _sim->getWidth() >> _lodLevels, _sim->getHeight() >> _lodLevels, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _lodLevels);
+    _uploadedLodVersions.assign(_sim->getChunksX() * _sim->getChunksY(), 0);
+    _lodScratch.resize(SIMULATION_CHUNK_SIZE * SIMULATION_CHUNK_SIZE);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST); // Integer textures can't be filtered
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    _uploadedChunkVersions.assign(_sim->getChunksX() * _sim->getChunksY(), 0);
+}
+
+bool Renderer::beginRebuild()
+{
+    // Nothing moved and the view shows the same chunks, last frame's buffers are still right
+    if (_instancesValid && _instanceGridVersion == _sim->getGridVersion() && _instanceChunks == _visibleChunks) { return false; }
+    _instanceGridVersion = _sim->getGridVersion();
+    _instanceChunks = _visibleChunks;
+    _instancesValid = true;
+    return true;
+}
+
+// A stream that could not be mapped draws nothing this frame and is rebuilt the next
+void Renderer::dropRebuild()
+{
+    _instancesValid = false;
+    _instanceCount = 0;
+}
+
+void Renderer::uploadInstancedQuads()
+{
+    if (!beginRebuild()) { return; }
+
+    // The instance builder writes straight into the mapped segment
+    char* segment = static_cast<char*>(_instanceStream->beginWrite());
+    if (segment == nullptr) { dropRebuild(); return; }
+    int instanceCount = _sim->calculateInstanceData(reinterpret_cast<glm::vec2*>(segment),
+        reinterpret_cast<Simulation::TileType*>(segment + _typesOffset), _visibleChunks);
+    _instanceStream->endWrite();
+    _instanceCount = instanceCount;
+
+    // Point the instance attributes at the segment that was just written
+    size_t offset = _instanceStream->getOffset();
+    glBindVertexArray(_quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, _instanceStream->getBuffer());
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)offset);
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_BYTE, sizeof(Simulation::TileType), (void*)(offset + _typesOffset));
+
+    _uploadedBytes = instanceCount * (sizeof(glm::vec2) + sizeof(Simulation::TileType));
+}
+
+void Renderer::uploadPackedQuads()
+{
+    if (!beginRebuild()) { return; }
+
+    uint32_t* instances = static_cast<uint32_t*>(_packedStream->beginWrite());
+    if (instances == nullptr) { dropRebuild(); return; }
+    _instanceCount = _sim->calculatePackedInstanceData(instances, _visibleChunks);
+    _packedStream->endWrite();
+
+    glBindVertexArray(_mode == RENDER_POINT_SPRITES ? _pointVAO : _packedVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, _packedStream->getBuffer());
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)_packedStream->getOffset());
+
+    _uploadedBytes = _instanceCount * sizeof(uint32_t);
+}
+
+void Renderer::uploadMergedRuns()
+{
+    if (!beginRebuild()) { return; }
+
+    uint32_t* runs = static_cast<uint32_t*>(_runStream->beginWrite());
+    if (runs == nullptr) { dropRebuild(); return; }
+    _instanceCount = _sim->calculateRunInstanceData(runs, _visibleChunks);
+    _runStream->endWrite();
+
+    size_t offset = _runStream->getOffset();
+    glBindVertexArray(_runVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, _runStream->getBuffer());
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, 2 * sizeof(uint32_t), (void*)offset);
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, 2 * sizeof(uint32_t), (void*)(offset + sizeof(uint32_t)));
+
+    _uploadedBytes = _instanceCount * 2 * sizeof(uint32_t);
+}
+
+void Renderer::uploadIncrementalQuads()
+{
+    if (_instancesValid && _instanceGridVersion == _sim->getGridVersion()) { return; }
+    _instanceGridVersion = _sim->getGridVersion();
+
+    if (!_instancesValid) {
+        _sim->clearChanges();
+        _slots->rebuild();
+        _instancesValid = true;
+    }
+    else {
+        _slots->applyChanges();
+    }
+    _instanceCount = _slots->getSlotCount();
+
+    glBindBuffer(GL_ARRAY_BUFFER, _slotPositionVBO);
+    if (_slots->needsFullUpload()) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, _instanceCount * sizeof(glm::vec2), _slots->getPositions());
+        glBindBuffer(GL_ARRAY_BUFFER, _slotTypeVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, _instanceCount * sizeof(Simulation::TileType), _slots->getTypes());
+        _uploadedBytes = _instanceCount * (sizeof(glm::vec2) + sizeof(Simulation::TileType));
+    }
+    else {
+        const std::vector<InstanceSlots::Range>& ranges = _slots->getDirtyRanges();
+        for (const InstanceSlots::Range& range : ranges) {
+            glBufferSubData(GL_ARRAY_BUFFER, range.begin * sizeof(glm::vec2), (range.end - range.begin) * sizeof(glm::vec2),
+                _slots->getPositions() + range.begin);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, _slotTypeVBO);
+        for (const InstanceSlots::Range& range : ranges) {
+            glBufferSubData(GL_ARRAY_BUFFER, range.begin * sizeof(Simulation::TileType), (range.end - range.begin) * sizeof(Simulation::TileType),
+                _slots->getTypes() + range.begin);
+            _uploadedBytes += (range.end - range.begin) * (sizeof(glm::vec2) + sizeof(Simulation::TileType));
+        }
+    }
+    _slots->clearDirty();
+}
+
+void Renderer::uploadGridTexture()
+{
+    glBindTexture(GL_TEXTURE_2D, _gridTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, SIMULATION_CHUNK_SIZE);
+
+    // Only visible chunks whose version moved since the last upload are sent, the rest catch up once in view
+    for (int chunkY = 0; chunkY < _sim->getChunksY(); ++chunkY) {
+        for (int chunkX = 0; chunkX < _sim->getChunksX(); ++chunkX) {
+            uint32_t version = _sim->getChunkVersion(chunkX, chunkY);
+            uint32_t& uploaded = _uploadedChunkVersions[chunkY * _sim->getChunksX() + chunkX];
+            if (_gridTextureValid && (uploaded == version || !isVisible(chunkX, chunkY))) { continue; }
+
+            int x = chunkX * SIMULATION_CHUNK_SIZE;
+            int y = chunkY * SIMULATION_CHUNK_SIZE;
+            int width = std::min(SIMULATION_CHUNK_SIZE, _sim->getWidth() - x);
+            int height = std::min(SIMULATION_CHUNK_SIZE, _sim->getHeight() - y);
+
+            const Simulation::TileType* tiles = _sim->getChunkTiles(chunkX, chunkY);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, tiles ? tiles : emptyChunk);
+
+            uploaded = version;
+            _uploadedBytes += width * height;
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    _gridTextureValid = true;
+}
+
+void Renderer::uploadLodLevels()
+{
+    glBindTexture(GL_TEXTURE_2D, _gridTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (int chunkY = 0; chunkY < _sim->getChunksY(); ++chunkY) {
+        for (int chunkX = 0; chunkX < _sim->getChunksX(); ++chunkX) {
+            uint32_t version = _sim->getChunkVersion(chunkX, chunkY);
+            uint32_t& uploaded = _uploadedLodVersions[chunkY * _sim->getChunksX() + chunkX];
+            if (_lodTextureValid && (uploaded == version || !isVisible(chunkX, chunkY))) { continue; }
+
+            // Level n is built from level n - 1 in place, the scratch block shrinks with every level
+            const Simulation::TileType* source = _sim->getChunkTiles(chunkX, chunkY);
+            Simulation::TileType* target = _lodScratch.data();
+            for (int level = 1; level <= _lodLevels; ++level) {
+                int size = SIMULATION_CHUNK_SIZE >> level;
+                if (source != nullptr) {
+                    for (int y = 0; y < size; ++y) {
+                        const Simulation::TileType* top = source + (2 * y) * (2 * size);
+                        const Simulation::TileType* bottom = top + 2 * size;
+                        for (int x = 0; x < size; ++x) {
+                            target[y * size + x] = downsample(top[2 * x], top[2 * x + 1], bottom[2 * x], bottom[2 * x + 1]);
+                        }
+                    }
+                }
+
+                int x = chunkX * size;
+                int y = chunkY * size;
+                int width = std::min(size, (_sim->getWidth() >> level) - x);
+                int height = std::min(size, (_sim->getHeight() >> level) - y);
+                if (width > 0 && height > 0) {
+                    glPixelStorei(GL_UNPACK_ROW_LENGTH, size);
+                    glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, source ? target : emptyChunk);
+                    _uploadedBytes += width * height;
+                }
+                if (source != nullptr) { source = target; }
+            }
+
+            uploaded = version;
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    _lodTextureValid = true;
+}
+
+Simulation::ChunkRange Renderer::getVisibleChunks()
+{
+    // World to grid is x = (world.x + 1) / cellSize, y = (1 - world.y) / cellSize
+    glm::vec2 minWorld = _camera->getVisibleMin();
+    glm::vec2 maxWorld = _camera->getVisibleMax();
+    float cellSize = _sim->getCellSize();
+
+    int minX = std::max((int)std::floor((minWorld.x + 1.0f) / cellSize), 0);
+    int maxX = std::min((int)std::floor((maxWorld.x + 1.0f) / cellSize), _sim->getWidth() - 1);
+    int minY = std::max((int)std::floor((1.0f - maxWorld.y) / cellSize), 0);
+    int maxY = std::min((int)std::floor((1.0f - minWorld.y) / cellSize), _sim->getHeight() - 1);
+
+    // The camera keeps part of the grid on screen, clamp anyway so the range is never empty
+    Simulation::ChunkRange range;
+    range.minX = std::min(minX, _sim->getWidth() - 1) >> SIMULATION_CHUNK_SHIFT;
+    range.maxX = std::max(maxX, 0) >> SIMULATION_CHUNK_SHIFT;
+    range.minY = std::min(minY, _sim->getHeight() - 1) >> SIMULATION_CHUNK_SHIFT;
+    range.maxY = std::max(maxY, 0) >> SIMULATION_CHUNK_SHIFT;
+    range.maxX = std::max(range.maxX, range.minX);
+    range.maxY = std::max(range.maxY, range.minY);
+    return range;
+}
+
+bool Renderer::isVisible(int chunkX, int chunkY)
+{
+    return chunkX >= _visibleChunks.minX && chunkX <= _visibleChunks.maxX && chunkY >= _visibleChunks.minY && chunkY <= _visibleChunks.maxY;
+}
+
+void Renderer::applyCamera(Shader* shader)
+{
+    glm::vec2 center = _camera->getCenter();
+    glUniform2f(shader->getUniformLocation("uCameraCenter"), center.x, center.y);
+    glUniform1f(shader->getUniformLocation("uCameraZoom"), _camera->getZoom());
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include "Simulation.h"
+#include "Camera.h"
+#include "Shaders/Shader.h"
+#include "InstanceSlots.h"
+#include "StreamingBuffer.h"
+
+class Renderer
+{
+public:
+	enum RenderMode {
+		RENDER_INSTANCED_QUADS = 0,   // One instanced quad per non-empty cell, rebuilt when the grid changes
+		RENDER_GRID_TEXTURE = 1,      // Grid as an R8UI texture, one fullscreen triangle
+		RENDER_INCREMENTAL_QUADS = 2, // Instanced quads in stable slots, only changed slots are uploaded
+		RENDER_PACKED_QUADS = 3,      // Instanced quads from one uint32 per cell, positions computed in the shader
+		RENDER_MERGED_RUNS = 4,       // One stretched packed quad per horizontal run of a material
+		RENDER_POINT_SPRITES = 5,     // One GL_POINTS vertex per cell from the packed instances
+		RENDER_MODE_COUNT
+	};
+
+	static const char* const MODE_NAMES[RENDER_MODE_COUNT];
+
+	Renderer(Simulation* sim, Camera* camera);
+	void setMode(RenderMode mode);
+	RenderMode getMode() { return _mode; }
+
+	void upload();
+	void draw();
+	size_t getUploadedBytes() { return _uploadedBytes; } // Bytes sent to the GPU by the last upload()
+	int getInstanceCount() { return _instanceCount; }
+	int getLod() { return _lod; } // Pyramid level drawn instead of cells, 0 when cells are at least a pixel
+	int getVisibleChunkCount() { return (_visibleChunks.maxX - _visibleChunks.minX + 1) * (_visibleChunks.maxY - _visibleChunks.minY + 1); }
+
+private:
+	Simulation* _sim;
+	Camera* _camera;
+	RenderMode _mode = RENDER_INCREMENTAL_QUADS;
+	size_t _uploadedBytes = 0;
+	int _instanceCount = 0;
+	uint32_t _instanceGridVersion = 0;
+	bool _instancesValid = false;
+
+	// View state, refreshed by upload()
+	int _viewportWidth = 0, _viewportHeight = 0;
+	Simulation::ChunkRange _visibleChunks;
+	Simulation::ChunkRange _instanceChunks; // Visible chunks when the instances were built
+	int _lod = 0;
+
+	// Instanced quads
+	Shader* _quadShader;
+	unsigned int _quadVAO, _quadVBO;
+	StreamingBuffer* _instanceStream; // Positions for a full grid followed by the types
+	size_t _typesOffset;
+
+	// Incremental quads, same layout and shader as the instanced quads
+	InstanceSlots* _slots;
+	unsigned int _slotVAO, _slotPositionVBO, _slotTypeVBO;
+
+	// Packed quads, same shader with uPacked set
+	unsigned int _packedVAO;
+	StreamingBuffer* _packedStream;
+	int _packedLocation;
+
+	// Point sprites, reads the packed quads buffer as plain vertices
+	Shader* _pointShader;
+	unsigned int _pointVAO;
+	int _viewportSizeLocation;
+
+	// Merged runs, packed quads with a run length per instance
+	unsigned int _runVAO;
+	StreamingBuffer* _runStream;
+	int _runsLocation;
+
+	// Material colours and grain spread, shared by every shader on texture unit 1
+	unsigned int _paletteTexture;
+
+	// Grid texture
+	Shader* _gridShader;
+	unsigned int _gridVAO, _gridTexture;
+	std::vector<uint32_t> _uploadedChunkVersions;
+	bool _gridTextureValid = false;
+
+	// Downsampled pyramid in mip levels 1.._lodLevels of the grid texture, one chunk maps to one block per level
+	int _lodLevels;
+	std::vector<uint32_t> _uploadedLodVersions;
+	std::vector<Simulation::TileType> _lodScratch;
+	bool _lodTextureValid = false;
+
+	void createPalette();
+	void createInstancedQuads();
+	void createIncrementalQuads();
+	void createPackedQuads();
+	void createMergedRuns();
+	void createPointSprites();
+	void createGridTexture();
+	void uploadInstancedQuads();
+	void uploadPackedQuads();
+	void uploadMergedRuns();
+	void uploadIncrementalQuads();
+	void uploadGridTexture();
+	void uploadLodLevels();
+	bool beginRebuild();
+	void dropRebuild();
+	Simulation::ChunkRange getVisibleChunks();
+	bool isVisible(int chunkX, int chunkY);
+	void applyCamera(Shader* shader);
+	void bindQuadAttributes(unsigned int positionVBO, unsigned int typeVBO);
+};
@@ -0,0 +1,255 @@
+#include "Scenario.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+const char* const Scenario::NAMES[SCENARIO_COUNT] = {
+    "dam-break", "hourglass", "rain", "sand-into-lake", "checkerboard", "avalanche", "drizzle"
+};
+
+const char* const Scenario::EXPECTED[SCENARIO_COUNT] = {
+    "A water column on the left quarter floods the floor and settles into a level layer",
+    "Sand in the upper bulb drains through the neck, nothing is left above it once settled",
+    "Never settles: sand and water drops land every tick and fill the grid from the bottom",
+    "A sand block sinks through the lake, settled columns read air, water, then sand",
+    "Half the cells, sand or water in a checkerboard, collapse into a level bed with sand below water",
+    "The whole upper grid drops as one block and settles as a flat, solid sand bed",
+    "Never settles: one water drop a tick per 256 columns builds a thin layer under a mostly empty grid",
+};
+
+namespace
+{
+    const int LEVEL_TOLERANCE = 4; // Water only steps sideways 4 cells at a time, so it can rest on 3-cell ledges
+}
+
+int Scenario::find(const char* name)
+{
+    for (int id = 0; id < SCENARIO_COUNT; ++id) {
+        if (std::strcmp(NAMES[id], name) == 0) { return id; }
+    }
+    return -1;
+}
+
+Scenario::Scenario(Id id, unsigned int seed)
+    : _id(id), _seed(seed), _rng(seed)
+{
+}
+
+void Scenario::place(Simulation& sim, int x, int y, Simulation::TileType type)
+{
+    if (!sim.isValidTile(x, y) || sim.getTile(x, y) != Simulation::TILE_EMPTY) { return; }
+    sim.setTile(x, y, type);
+    _expected[type]++;
+}
+
+void Scenario::setUp(Simulation& sim)
+{
+    sim.clear();
+    _rng.seed(_seed);
+    std::fill(_expected, _expected + Simulation::TILE_TYPE_COUNT, 0);
+    _startTick = sim.getTickCount();
+    _fedTick = _startTick; // The next tick still gets its grains
+
+    int width = sim.getWidth(), height = sim.getHeight();
+    switch (_id) {
+    case SCENARIO_DAM_BREAK:
+        for (int y = height / 4; y < height; ++y) {
+            for (int x = 0; x < width / 4; ++x) { place(sim, x, y, Simulation::TILE_WATER); }
+        }
+        break;
+
+    case SCENARIO_HOURGLASS:
+        drawHourglass(sim);
+        break;
+
+    case SCENARIO_SAND_INTO_LAKE:
+        for (int y = height / 2; y < height; ++y) {
+            for (int x = 0; x < width; ++x) { place(sim, x, y, Simulation::TILE_WATER); }
+        }
+        for (int y = height / 8; y < height / 4; ++y) {
+            for (int x = width / 3; x < 2 * width / 3; ++x) {
+                if (_rng() % 4 != 0) { place(sim, x, y, Simulation::TILE_SAND); }
+            }
+        }
+        break;
+
+    case SCENARIO_CHECKERBOARD:
+        for (int y = 0; y < height; ++y) {
+            for (int x = (y & 1); x < width; x += 2) { place(sim, x, y, (_rng() & 1) ? Simulation::TILE_SAND : Simulation::TILE_WATER); }
+        }
+        break;
+
+    case SCENARIO_AVALANCHE:
+        for (int y = 0; y < height - height / 4; ++y) {
+            for (int x = 0; x < width; ++x) { place(sim, x, y, Simulation::TILE_SAND); }
+        }
+        break;
+
+    default: break; // The sources start from an empty grid
+    }
+}
+
+void Scenario::drawHourglass(Simulation& sim)
+{
+    int width = sim.getWidth(), height = sim.getHeight();
+    int centerX = width / 2, neckY = height / 2;
+    int neck = std::max(2, width / 40); // Half width of the opening
+    int top = height / 8, bottom = height - height / 8;
+    int maxHalf = std::max(neck, centerX - 3);
+
+    // Walls steeper than the 45 degree slope sand rests at, two cells thick because grains also move diagonally
+    for (int y = top; y <= bottom + 2; ++y) {
+        int half = std::min(maxHalf, neck + std::abs(std::min(y, bottom) - neckY) / 2);
+        if (y > bottom) {
+            for (int x = centerX - half - 2; x < centerX + half + 2; ++x) { place(sim, x, y, Simulation::TILE_STONE); } // Floor
+            continue;
+        }
+        place(sim, centerX - half - 2, y, Simulation::TILE_STONE);
+        place(sim, centerX - half - 1, y, Simulation::TILE_STONE);
+        place(sim, centerX + half, y, Simulation::TILE_STONE);
+        place(sim, centerX + half + 1, y, Simulation::TILE_STONE);
+    }
+
+    // The lower two thirds of the upper bulb, which leaves room for the pile below
+    for (int y = top + (neckY - top) / 3; y < neckY; ++y) {
+        int half = std::min(maxHalf, neck + (neckY - y) / 2);
+        for (int x = centerX - half; x < centerX + half; ++x) { place(sim, x, y, Simulation::TILE_SAND); }
+    }
+}
+
+void Scenario::update(Simulation& sim)
+{
+    uint32_t tick = sim.getTickCount() + 1; // The tick the next step() runs
+    if (tick == _fedTick) { return; }
+    _fedTick = tick;
+
+    int width = sim.getWidth();
+    if (_id == SCENARIO_RAIN) {
+        for (int i = 0; i < std::max(1, width / 8); ++i) {
+            int x = (int)(_rng() % (unsigned int)width);
+            place(sim, x, 0, (_rng() & 1) ? Simulation::TILE_SAND : Simulation::TILE_WATER);
+        }
+    }
+    else if (_id == SCENARIO_DRIZZLE) {
+        for (int i = 0; i < std::max(1, width / 256); ++i) {
+            place(sim, (int)(_rng() % (unsigned int)width), 0, Simulation::TILE_WATER);
+        }
+    }
+}
+
+int Scenario::getSettleTicks(Simulation& sim)
+{
+    int width = sim.getWidth(), height = sim.getHeight();
+    switch (_id) {
+    case SCENARIO_HOURGLASS: return 4 * (width + height) + (int)_expected[Simulation::TILE_SAND]; // Once the column over the neck has dropped, about a grain a tick
+    case SCENARIO_DAM_BREAK: return 4 * (width + height) + width * width / 16; // Levelling spreads like diffusion
+    case SCENARIO_RAIN:
+    case SCENARIO_DRIZZLE: return 0;
+    default: return 4 * (width + height);
+    }
+}
+
+bool Scenario::check(Simulation& sim, std::string& failure)
+{
+    int64_t counts[Simulation::TILE_TYPE_COUNT] = {};
+    for (int chunkY = 0; chunkY < sim.getChunksY(); ++chunkY) {
+        for (int chunkX = 0; chunkX < sim.getChunksX(); ++chunkX) {
+            const Simulation::TileType* tiles = sim.getChunkTiles(chunkX, chunkY);
+            if (tiles == nullptr) { continue; }
+            int rows = std::min(SIMULATION_CHUNK_SIZE, sim.getHeight() - chunkY * SIMULATION_CHUNK_SIZE);
+            int columns = std::min(SIMULATION_CHUNK_SIZE, sim.getWidth() - chunkX * SIMULATION_CHUNK_SIZE);
+            for (int y = 0; y < rows; ++y) {
+                for (int x = 0; x < columns; ++x) { counts[tiles[y * SIMULATION_CHUNK_SIZE + x]]++; }
+            }
+        }
+    }
+
+    char text[256];
+    for (int type = Simulation::TILE_SAND; type < Simulation::TILE_TYPE_COUNT; ++type) {
+        if (counts[type] != _expected[type]) {
+            std::snprintf(text, sizeof(text), "%lld %s tiles, expected %lld", (long long)counts[type],
+                Simulation::MATERIALS[type].name, (long long)_expected[type]);
+            failure = text;
+            return false;
+        }
+    }
+
+    // Too early to expect the steady state
+    uint32_t ticks = sim.getTickCount() - _startTick;
+    if (hasSources() || (!sim.isSettled() && ticks < (uint32_t)getSettleTicks(sim))) { return true; }
+
+    if (comesToRest() && !sim.isSettled()) {
+        std::snprintf(text, sizeof(text), "still moving after %u ticks, expected to rest within %d", ticks, getSettleTicks(sim));
+        failure = text;
+        return false;
+    }
+    return checkSteadyState(sim, failure);
+}
+
+bool Scenario::checkSteadyState(Simulation& sim, std::string& failure)
+{
+    int width = sim.getWidth(), height = sim.getHeight();
+    char text[256];
+
+    // Sand has stopped falling and sinking. Surface water may still step across an air gap.
+    for (int y = 0; y + 1 < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            Simulation::TileType below = sim.getTile(x, y + 1);
+            if (sim.getTile(x, y) == Simulation::TILE_SAND && (below == Simulation::TILE_EMPTY || below == Simulation::TILE_WATER)) {
+                std::snprintf(text, sizeof(text), "sand resting on %s at %d,%d", sim.getTileName(below), x, y);
+                failure = text;
+                return false;
+            }
+        }
+    }
+
+    switch (_id) {
+    case SCENARIO_DAM_BREAK:
+    case SCENARIO_SAND_INTO_LAKE:
+    case SCENARIO_CHECKERBOARD: {
+        // Grains stack from the floor without gaps, so the surface is the filled height of each column
+        int lowest = height, highest = 0;
+        for (int x = 0; x < width; ++x) {
+            int filled = 0;
+            for (int y = height - 1; y >= 0 && sim.getTile(x, y) != Simulation::TILE_EMPTY; --y) { filled++; }
+            lowest = std::min(lowest, filled);
+            highest = std::max(highest, filled);
+        }
+        if (highest - lowest > LEVEL_TOLERANCE) {
+            std::snprintf(text, sizeof(text), "surface not level, columns %d to %d tiles high", lowest, highest);
+            failure = text;
+            return false;
+        }
+        break;
+    }
+
+    case SCENARIO_HOURGLASS:
+        for (int y = 0; y < height / 2; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (sim.getTile(x, y) == Simulation::TILE_SAND) {
+                    std::snprintf(text, sizeof(text), "sand left above the neck at %d,%d", x, y);
+                    failure = text;
+                    return false;
+                }
+            }
+        }
+        break;
+
+    case SCENARIO_AVALANCHE:
+        for (int y = height / 4; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (sim.getTile(x, y) != Simulation::TILE_SAND) {
+                    std::snprintf(text, sizeof(text), "hole in the sand bed at %d,%d", x, y);
+                    failure = text;
+                    return false;
+                }
+            }
+        }
+        break;
+
+    default: break;
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include "Simulation.h"
+
+// Named, seeded workloads for the window, the windowless runners and the benchmarks. setUp()
+// writes the start state, update() feeds the sources of the scenarios that keep adding grains,
+// and check() compares the grid with the steady state the scenario is expected to reach.
+// The same name, seed and grid size always give the same ticks.
+class Scenario
+{
+public:
+	enum Id {
+		SCENARIO_DAM_BREAK = 0,
+		SCENARIO_HOURGLASS,
+		SCENARIO_RAIN,
+		SCENARIO_SAND_INTO_LAKE,
+		SCENARIO_CHECKERBOARD,
+		SCENARIO_AVALANCHE,
+		SCENARIO_DRIZZLE,
+		SCENARIO_COUNT
+	};
+	static const char* const NAMES[SCENARIO_COUNT];
+	static const char* const EXPECTED[SCENARIO_COUNT]; // The steady state in words, what check() tests
+	static int find(const char* name); // -1 if no scenario has that name
+
+	Scenario(Id id, unsigned int seed = 1);
+
+	void setUp(Simulation& sim); // Clears the grid first
+	void update(Simulation& sim); // Once per tick before step(), further calls in the same tick do nothing
+	// False with the reason when the grid breaks an expectation: grains lost or made at any tick, or,
+	// once settled or past getSettleTicks(), a grid that is not in the expected steady state
+	bool check(Simulation& sim, std::string& failure);
+
+	Id getId() { return _id; }
+	const char* getName() { return NAMES[_id]; }
+	bool hasSources() { return _id == SCENARIO_RAIN || _id == SCENARIO_DRIZZLE; } // Never settles
+	bool comesToRest() { return _id == SCENARIO_HOURGLASS || _id == SCENARIO_AVALANCHE; } // Sand only, every tile stops; water surfaces keep rippling
+	int getSettleTicks(Simulation& sim); // Ticks after setUp() by which it must have settled, 0 if it never does
+	int64_t getExpectedCount(Simulation::TileType type) { return _expected[type]; }
+
+private:
+	Id _id;
+	unsigned int _seed;
+	std::mt19937 _rng;
+	uint32_t _startTick = 0; // Simulation tick count at setUp()
+	uint32_t _fedTick = 0; // Last tick update() fed
+	int64_t _expected[Simulation::TILE_TYPE_COUNT] = {}; // Grains there should be, start state plus what the sources added
+
+	void place(Simulation& sim, int x, int y, Simulation::TileType type); // Counted, only into air
+	void drawHourglass(Simulation& sim);
+	bool checkSteadyState(Simulation& sim, std::string& failure);
+};
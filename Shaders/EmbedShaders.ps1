@@ -0,0 +1,25 @@
+# Embeds Shaders/*.glsl into Shaders/EmbeddedShaders.h as raw string literals.
+# Runs as the pre-build step, so the executable no longer needs the Shaders folder next to it.
+$shaderDir = $PSScriptRoot
+$output = Join-Path $shaderDir "EmbeddedShaders.h"
+
+$lines = @(
+    "// Generated from Shaders/*.glsl by EmbedShaders.ps1 before every build, do not edit",
+    "#pragma once",
+    "",
+    "struct EmbeddedShader { const char* name; const char* source; };",
+    "",
+    "static const EmbeddedShader EMBEDDED_SHADERS[] = {"
+)
+foreach ($file in Get-ChildItem -Path $shaderDir -Filter *.glsl | Sort-Object Name) {
+    $source = [System.IO.File]::ReadAllText($file.FullName)
+    $lines += "    { `"$($file.Name)`", R`"glsl($source)glsl`" },"
+}
+$lines += "};"
+$lines += "static const int EMBEDDED_SHADER_COUNT = sizeof(EMBEDDED_SHADERS) / sizeof(EMBEDDED_SHADERS[0]);"
+$content = ($lines -join "`r`n") + "`r`n"
+
+# Leave the header alone when nothing changed so Shader.cpp isn't rebuilt
+if (!(Test-Path $output) -or [System.IO.File]::ReadAllText($output) -ne $content) {
+    [System.IO.File]::WriteAllText($output, $content)
+}
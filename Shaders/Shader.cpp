@@ -1,14 +1,93 @@
 #include "Shader.h"
 #include <glad/glad.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include "../Config.h"
+#include "../MemoryTracker.h"
+
+// Generated by EmbedShaders.ps1 before every Visual Studio build. Builds without it read the .glsl files.
+#if defined(__has_include)
+#if __has_include("EmbeddedShaders.h")
+#include "EmbeddedShaders.h"
+#define HAS_EMBEDDED_SHADERS
+#endif
+#endif
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+int Shader::_cacheHits = 0;
+int Shader::_cacheMisses = 0;
+
+namespace
+{
+    const uint32_t CACHE_MAGIC = 0x53424743; // "SBGC"
+
+    uint64_t fnv1a(uint64_t hash, const char* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t fnv1a(uint64_t hash, const char* text)
+    {
+        return fnv1a(hash, text, std::strlen(text) + 1); // Terminator keeps "ab" + "c" apart from "a" + "bc"
+    }
+
+    // Binaries are only usable where the driver can hand them back
+    bool canCacheBinaries()
+    {
+        if (!GLAD_GL_VERSION_4_1) { return false; }
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+}
 
 Shader::Shader() {
 	_programID = glCreateProgram();
 }
 
-void Shader::link() {
+bool Shader::link() {
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_SHADERS);
+
+    bool cacheable = canCacheBinaries();
+    std::string cachePath = cacheable ? getCachePath() : std::string();
+    if (cacheable && loadCachedBinary(cachePath)) {
+        _cacheHits++;
+        _stages.clear();
+        return true;
+    }
+    _cacheMisses++;
+
+    for (const Stage& stage : _stages) {
+        unsigned int shaderID = glCreateShader(stage.type);
+        const char* shaderSource_char = stage.source.c_str();
+
+        glShaderSource(shaderID, 1, &shaderSource_char, 0);
+        glCompileShader(shaderID);
+        checkShaderCompileErrors(shaderID, stage.type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT");
+        glAttachShader(_programID, shaderID);
+        glDeleteShader(shaderID);
+    }
+
+    if (cacheable) { glProgramParameteri(_programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
 	glLinkProgram(_programID);
+    bool linked = checkProgramLinkErrors();
+    if (linked && cacheable) { saveCachedBinary(cachePath); }
+
+    _stages.clear();
+    return linked;
 }
 
 void Shader::use() {
@@ -16,33 +95,107 @@ void Shader::use() {
 }
 
 void Shader::attachShader(const char* fileName, GLenum shaderType) {
-	
-	unsigned int shaderID = glCreateShader(shaderType);
-	std::string shaderSource_string = getShaderFromFile(fileName);
-	const char* shaderSource_char = shaderSource_string.c_str();
+	MemoryTracker::Scope memoryScope(MemoryTracker::TAG_SHADERS);
+
+    Stage stage;
+    stage.type = shaderType;
+    stage.source = getShaderSource(fileName);
+    _stages.push_back(stage);
+}
 
-	glShaderSource(shaderID,1, &shaderSource_char, 0);
-	glCompileShader(shaderID);
-    checkShaderCompileErrors(shaderID, shaderType == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT");
-	glAttachShader(_programID,shaderID);
-	glDeleteShader(shaderID);
+std::string Shader::getShaderSource(const char* fileName) {
+#ifdef HAS_EMBEDDED_SHADERS
+    // Embedded shaders are keyed by file name, the directory doesn't matter
+    const char* name = std::strrchr(fileName, '/');
+    name = (name != nullptr) ? name + 1 : fileName;
+
+    for (int i = 0; i < EMBEDDED_SHADER_COUNT; ++i) {
+        if (std::strcmp(EMBEDDED_SHADERS[i].name, name) == 0) {
+            return EMBEDDED_SHADERS[i].source;
+        }
+    }
+#endif
+    return getShaderFromFile(fileName);
 }
 
 std::string Shader::getShaderFromFile(const char* fileName) {
-    std::ifstream file(fileName);
-    std::string data;
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_IO);
+    std::ifstream file(fileName, std::ios::binary);
 
     if (!file.is_open()) {
         std::cerr << "Error: Cannot open shader file: " << fileName << "\n";
-        return data;
+        return std::string();
     }
 
-    char readChar;
-    while ((readChar = file.get()) != EOF) {
-        data += readChar;
+    // One read for the whole file
+    std::ostringstream data;
+    data << file.rdbuf();
+    return data.str();
+}
+
+std::string Shader::getCachePath() {
+    // Key on the driver as well as the sources, binaries don't survive driver updates
+    uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, (const char*)glGetString(GL_VENDOR));
+    hash = fnv1a(hash, (const char*)glGetString(GL_RENDERER));
+    hash = fnv1a(hash, (const char*)glGetString(GL_VERSION));
+    for (const Stage& stage : _stages) {
+        hash = fnv1a(hash, (const char*)&stage.type, sizeof(stage.type));
+        hash = fnv1a(hash, stage.source.c_str());
     }
-    file.close();
-    return data;
+
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "/%016llx.bin", (unsigned long long)hash);
+    return std::string(SHADER_CACHE_DIR) + fileName;
+}
+
+bool Shader::loadCachedBinary(const std::string& path) {
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_IO);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) { return false; }
+
+    uint32_t magic = 0, length = 0;
+    GLenum format = 0;
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&format, sizeof(format));
+    file.read((char*)&length, sizeof(length));
+    if (!file || magic != CACHE_MAGIC || length == 0) { return false; }
+
+    std::vector<char> binary(length);
+    file.read(binary.data(), length);
+    if (!file) { return false; }
+
+    // The driver may still reject it, the caller compiles from source then
+    glProgramBinary(_programID, format, binary.data(), (GLsizei)length);
+    GLint success = 0;
+    glGetProgramiv(_programID, GL_LINK_STATUS, &success);
+    return success == GL_TRUE;
+}
+
+void Shader::saveCachedBinary(const std::string& path) {
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_IO);
+
+    GLint length = 0;
+    glGetProgramiv(_programID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) { return; }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(_programID, length, nullptr, &format, binary.data());
+
+#ifdef _WIN32
+    _mkdir(SHADER_CACHE_DIR);
+#else
+    mkdir(SHADER_CACHE_DIR, 0755);
+#endif
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) { return; }
+
+    uint32_t magic = CACHE_MAGIC, size = (uint32_t)length;
+    file.write((const char*)&magic, sizeof(magic));
+    file.write((const char*)&format, sizeof(format));
+    file.write((const char*)&size, sizeof(size));
+    file.write(binary.data(), length);
 }
 
 void Shader::checkShaderCompileErrors(GLuint shader, const std::string& type) {
@@ -53,4 +206,15 @@ void Shader::checkShaderCompileErrors(GLuint shader, const std::string& type) {
         glGetShaderInfoLog(shader, 1024, nullptr, infoLog);
         std::cerr << "Error: Shader Compile Error (" << type << "): " << infoLog << "\n";
     }
-}
\ No newline at end of file
+}
+
+bool Shader::checkProgramLinkErrors() {
+    GLint success;
+    glGetProgramiv(_programID, GL_LINK_STATUS, &success);
+    if (!success) {
+        GLchar infoLog[1024];
+        glGetProgramInfoLog(_programID, 1024, nullptr, infoLog);
+        std::cerr << "Error: Shader Link Error: " << infoLog << "\n";
+    }
+    return success == GL_TRUE;
+}
@@ -2,6 +2,7 @@
 #define SHADERPROGRAM_HPP
 
 #include <string>
+#include <vector>
 #include <glad/glad.h>
 
 class Shader
@@ -9,9 +10,11 @@ class Shader
 public:
 	Shader();
 
+	// Sources come from the shaders embedded at build time, the file is only read when it isn't embedded.
+	// Compiling is deferred to link(), which skips it entirely when the program binary cache has a match.
 	void attachShader(const char* fileName, GLenum shaderType);
 
-	void link();
+	bool link();
 
 	void use();
 
@@ -25,12 +28,29 @@ public:
 		return glGetUniformLocation(_programID, varName);
 	}
 
+	// Startup counters over every Shader
+	static int getCacheHits() { return _cacheHits; }
+	static int getCacheMisses() { return _cacheMisses; }
+
 private:
+	struct Stage {
+		GLenum type;
+		std::string source;
+	};
+
 	unsigned int _programID;
+	std::vector<Stage> _stages;
+
+	static int _cacheHits, _cacheMisses;
 
+	std::string getShaderSource(const char* fileName);
 	std::string getShaderFromFile(const char* fileName);
+	std::string getCachePath();
+	bool loadCachedBinary(const std::string& path);
+	void saveCachedBinary(const std::string& path);
 
 	void checkShaderCompileErrors(GLuint shader, const std::string& type);
+	bool checkProgramLinkErrors();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,25 @@
+#version 330 core
+in vec2 NdcPos;
+out vec4 FragColor;
+
+uniform usampler2D uGrid;
+uniform float uCellSize;
+uniform ivec2 uGridSize;
+uniform vec2 uCameraCenter;
+uniform float uCameraZoom;
+uniform int uLod; // Pyramid level, each one halves the grid
+
+vec4 materialColor(int type, ivec2 cell); // palettefs.glsl
+
+void main() {
+    // Row 0 of the grid is the top of the screen
+    vec2 worldPos = NdcPos / uCameraZoom + uCameraCenter;
+    ivec2 cell = ivec2(floor(vec2(worldPos.x + 1.0, 1.0 - worldPos.y) / uCellSize));
+    if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, uGridSize))) { discard; }
+
+    cell >>= uLod;
+    if (any(greaterThanEqual(cell, uGridSize >> uLod))) { discard; }
+    uint TypeIndex = texelFetch(uGrid, cell, uLod).r;
+    if (TypeIndex == 0u) { discard; } // TILE_EMPTY: let the clear colour through
+    FragColor = materialColor(int(TypeIndex), cell);
+}
@@ -0,0 +1,9 @@
+#version 330 core
+out vec2 NdcPos;
+
+void main() {
+    // Fullscreen triangle from the vertex index, no vertex buffer needed
+    vec2 pos = vec2((gl_VertexID == 1) ? 3.0 : -1.0, (gl_VertexID == 2) ? 3.0 : -1.0);
+    gl_Position = vec4(pos, 0.0, 1.0);
+    NdcPos = pos;
+}
@@ -0,0 +1,21 @@
+#version 330 core
+// Linked into every fragment stage that colours cells.
+// Palette texel per TileType: rgb is the colour, alpha the per-grain brightness spread.
+uniform sampler2D uPalette;
+
+// lowbias32 integer hash, mirrored by Simulation::grainHash
+uint grainHash(ivec2 cell) {
+    uint h = uint(cell.x) | (uint(cell.y) << 16);
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+vec4 materialColor(int type, ivec2 cell) {
+    vec4 entry = texelFetch(uPalette, ivec2(type, 0), 0);
+    float grain = float(grainHash(cell) & 0xFFFFu) / 65535.0;
+    return vec4(entry.rgb * (1.0 - entry.a + 2.0 * entry.a * grain), 1.0);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 3) in uint aPackedCell; // x | y << 13 | type << 26
+
+flat out int TypeIndex;
+out vec2 WorldPos;
+uniform float uCellSize;
+uniform vec2 uViewportSize;
+uniform vec2 uCameraCenter;
+uniform float uCameraZoom;
+
+void main() {
+    vec2 cell = vec2(float(aPackedCell & 0x1FFFu), float((aPackedCell >> 13) & 0x1FFFu));
+    WorldPos = vec2(-1.0, 1.0) + vec2(cell.x + 0.5, -(cell.y + 0.5)) * uCellSize;
+    gl_Position = vec4((WorldPos - uCameraCenter) * uCameraZoom, 0.0, 1.0);
+
+    // A cell spans uCellSize * uCameraZoom in NDC, half the viewport per NDC unit
+    // Points are clipped by their centre, so cells cut by the screen edge drop out whole
+    gl_PointSize = uCellSize * uCameraZoom * 0.5 * uViewportSize.x;
+    TypeIndex = int(aPackedCell >> 26);
+}
@@ -1,19 +1,14 @@
 #version 330 core
 flat in int TypeIndex;
+in vec2 WorldPos;
 out vec4 FragColor;
 
-void main() {
-    vec4 color;
-    if (TypeIndex == 1) { // TILE_SAND
-        color = vec4(0.76, 0.70, 0.50, 1.0);
-    }
-    else if (TypeIndex == 2) {
-        color = vec4(0.0f, 0.4f, 0.65f, 1.0f);
-    }
+uniform float uCellSize;
 
-    else {
-        color = vec4(0.0, 0.0, 0.0, 0.0); // TILE_EMPTY: effaf
-    }
-    FragColor = color;
+vec4 materialColor(int type, ivec2 cell); // palettefs.glsl
 
-}
\ No newline at end of file
+void main() {
+    // Cell under the fragment, a merged run spans several
+    ivec2 cell = ivec2(floor(vec2(WorldPos.x + 1.0, 1.0 - WorldPos.y) / uCellSize));
+    FragColor = materialColor(TypeIndex, cell);
+}
@@ -2,12 +2,30 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aInstancePos;
 layout (location = 2) in int aTypeIndex;
+layout (location = 3) in uint aPackedCell; // x | y << 13 | type << 26
+layout (location = 4) in uint aRunLength;  // Cells covered to the right of the packed cell
 
 flat out int TypeIndex;
+out vec2 WorldPos;
 uniform float uCellSize;
+uniform bool uPacked;
+uniform bool uRuns;
+uniform vec2 uCameraCenter;
+uniform float uCameraZoom;
 
 void main() {
-    vec2 scaledPos = aPos.xy * uCellSize;
-    gl_Position = vec4(scaledPos + aInstancePos, aPos.z, 1.0);
-    TypeIndex = aTypeIndex;
-}
\ No newline at end of file
+    vec2 instancePos = aInstancePos;
+    int typeIndex = aTypeIndex;
+    float runLength = uRuns ? float(aRunLength) : 1.0;
+    if (uPacked) {
+        vec2 cell = vec2(float(aPackedCell & 0x1FFFu), float((aPackedCell >> 13) & 0x1FFFu));
+        instancePos = vec2(-1.0, 1.0) + vec2(cell.x + 0.5 * runLength, -(cell.y + 0.5)) * uCellSize;
+        typeIndex = int(aPackedCell >> 26);
+    }
+
+    vec2 scaledPos = aPos.xy * vec2(runLength, 1.0) * uCellSize;
+    WorldPos = scaledPos + instancePos;
+    gl_Position = vec4((WorldPos - uCameraCenter) * uCameraZoom, aPos.z, 1.0);
+    if (typeIndex == 0) { gl_Position = vec4(2.0, 2.0, 2.0, 1.0); } // Free slot, push it outside the clip volume
+    TypeIndex = typeIndex;
+}
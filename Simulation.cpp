@@ -1,27 +1,83 @@
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include "Simulation.h"
 #include "FrameCounter.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include "PerfCounters.h"
+#include "ThreadPool.h"
 
 FrameCounter* frameCounter = new FrameCounter();
 
+const Simulation::Material Simulation::MATERIALS[TILE_TYPE_COUNT] = {
+    { "Air",   { 0.0f,  0.0f, 0.0f  }, 0.0f  },
+    { "Sand",  { 0.76f, 0.70f, 0.50f }, 0.12f },
+    { "Water", { 0.0f,  0.4f, 0.65f }, 0.04f },
+    { "Stone", { 0.42f, 0.42f, 0.45f }, 0.10f },
+};
+
+const char* const Simulation::ENGINE_NAMES[ENGINE_COUNT] = { "serial", "striped" };
+
+Simulation::Simulation(int width, int height)
+    : chunkAllocator(sizeof(Chunk), USE_HUGE_PAGES)
+{
+    this->width = width;
+    this->height = height;
+    chunksX = (width + SIMULATION_CHUNK_SIZE - 1) >> SIMULATION_CHUNK_SHIFT;
+    chunksY = (height + SIMULATION_CHUNK_SIZE - 1) >> SIMULATION_CHUNK_SHIFT;
+    cellSize = 2.0f / std::max(width, height);
+
+    MemoryTracker::Scope simulationScope(MemoryTracker::TAG_SIMULATION);
+    chunks.assign(chunksX * chunksY, nullptr);
+    chunkVersions.assign(chunksX * chunksY, 0);
+    chunkAllocator.reserve(chunks.size());
+    stripeTallies.resize(chunksY);
+    stripeChanges.resize(chunksY);
+
+    // splitmix64 of the index, rows and columns drawn from separate ranges
+    rowKeys.resize(height);
+    columnKeys.resize(width);
+    for (int i = 0; i < width + height; ++i) {
+        uint64_t key = (uint64_t)(i + 1) * 0x9e3779b97f4a7c15ull;
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+        key ^= key >> 31;
+        if (i < height) { rowKeys[i] = key; }
+        else { columnKeys[i - height] = key; }
+    }
+}
+
+Simulation::~Simulation()
+{
+    for (Chunk* chunk : chunks) {
+        chunkAllocator.release(chunk);
+    }
+}
+
 void Simulation::update(){
     frameCounter->update();
     simulateGrid();
-    calculateInstanceData();
 }
 
-std::string Simulation::getTileName(TileType type)
+void Simulation::buildPalette(uint8_t palette[MAX_MATERIALS * 4])
 {
-    switch (type)
-    {
-    case TILE_EMPTY: return "Air";
-    case TILE_SAND: return "Sand";
-    case TILE_WATER: return "Water";
-
-    default: return "Unknown";
+    std::memset(palette, 0, MAX_MATERIALS * 4);
+    for (int type = 0; type < TILE_TYPE_COUNT; ++type) {
+        for (int channel = 0; channel < 3; ++channel) {
+            palette[type * 4 + channel] = (uint8_t)(MATERIALS[type].color[channel] * 255.0f + 0.5f);
+        }
+        palette[type * 4 + 3] = (uint8_t)(MATERIALS[type].variation * 255.0f + 0.5f);
     }
 }
 
+const char* Simulation::getTileName(TileType type)
+{
+    if (type >= TILE_TYPE_COUNT) { return "Unknown"; }
+    return MATERIALS[type].name;
+}
+
 double Simulation::getFPS()
 {
     if (frameCounter == nullptr) { return -1; }
@@ -32,127 +88,462 @@ bool Simulation::isSimulationFrame(FrameCounter* frameCounter){
 	return (frameCounter->currentFrame % SIMULATION_INTERVAL_IN_FRAMES == 0);
 }
 
-bool Simulation::isValidTile(int x, int y){
-	return (x >= 0 && x < SIMULATION_GRID_WIDTH && y >= 0 && y < SIMULATION_GRID_HEIGHT);
+Simulation::Chunk* Simulation::wakeChunk(int x, int y)
+{
+    Chunk*& chunk = chunkAt(x, y);
+    if (chunk == nullptr) {
+        chunk = static_cast<Chunk*>(chunkAllocator.allocate());
+        std::memset(chunk, 0, sizeof(Chunk)); // TILE_EMPTY in both generations
+    }
+    return chunk;
+}
+
+void Simulation::sleepEmptyChunks()
+{
+    for (Chunk*& chunk : chunks) {
+        if (chunk == nullptr) { continue; }
+
+        const TileType* tiles = &chunk->tiles[front][0][0];
+        const TileType* end = tiles + SIMULATION_CHUNK_SIZE * SIMULATION_CHUNK_SIZE;
+        if (std::find_if(tiles, end, [](TileType t) { return t != TILE_EMPTY; }) == end) {
+            chunkAllocator.release(chunk);
+            chunk = nullptr;
+        }
+    }
+}
+
+void Simulation::setChangeTracking(bool enabled)
+{
+    if (enabled == changeTracking) { return; }
+
+    changeTracking = enabled;
+    if (enabled) {
+        MemoryTracker::Scope memoryScope(MemoryTracker::TAG_SIMULATION);
+        changedFlags.assign(width * height, 0);
+        changedCells.reserve(width * height); // Each cell is listed once at most, so this never grows
+        reserveStripeChanges();
+    }
+    else {
+        clearChanges();
+    }
+}
+
+void Simulation::setEngine(Engine engine, ThreadPool* pool)
+{
+    this->engine = engine;
+    this->pool = pool;
+    reserveStripeChanges();
+}
+
+void Simulation::reserveStripeChanges()
+{
+    if (!changeTracking || engine != ENGINE_STRIPED) { return; }
+
+    // A stripe lists its own rows and the top row of the stripe below
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_SIMULATION);
+    for (std::vector<int>& changes : stripeChanges) { changes.reserve((SIMULATION_CHUNK_SIZE + 1) * width); }
+}
+
+void Simulation::clearChanges()
+{
+    for (int cell : changedCells) {
+        changedFlags[cell] = 0;
+    }
+    changedCells.clear();
+}
+
+const Simulation::TileType* Simulation::getChunkTiles(int chunkX, int chunkY)
+{
+    Chunk* chunk = chunks[chunkY * chunksX + chunkX];
+    return chunk ? &chunk->tiles[front][0][0] : nullptr;
+}
+
+const uint64_t Simulation::TYPE_KEYS[TILE_TYPE_COUNT] = { 0, 0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull };
+
+void Simulation::setStateHashing(StateHashing mode)
+{
+    hashingMode = mode;
+    enableStateHashing(mode != HASHING_OFF);
+}
+
+void Simulation::enableStateHashing(bool enabled)
+{
+    if (enabled && !stateHashing) {
+        stateHash = 0;
+        for (int chunkY = 0; chunkY < chunksY; ++chunkY) {
+            for (int chunkX = 0; chunkX < chunksX; ++chunkX) { stateHash += getChunkHash(chunkX, chunkY); }
+        }
+    }
+    if (!enabled) { hashedTicks = 0; }
+    stateHashing = enabled;
+}
+
+uint64_t Simulation::getChunkHash(int chunkX, int chunkY)
+{
+    const TileType* tiles = getChunkTiles(chunkX, chunkY);
+    if (tiles == nullptr) { return 0; }
+
+    uint64_t hash = 0;
+    int startX = chunkX << SIMULATION_CHUNK_SHIFT, startY = chunkY << SIMULATION_CHUNK_SHIFT;
+    int endX = std::min(startX + SIMULATION_CHUNK_SIZE, width), endY = std::min(startY + SIMULATION_CHUNK_SIZE, height);
+    for (int y = startY; y < endY; ++y) {
+        for (int x = startX; x < endX; ++x) { hash += cellHash(x, y, tiles[(y - startY) * SIMULATION_CHUNK_SIZE + (x - startX)]); }
+    }
+    return hash;
 }
 
 void Simulation::setTile(int x, int y, TileType type){
     if (isValidTile(x, y)) {
-        grid[y][x] = type;
+        if (type == TILE_EMPTY && chunkAt(x, y) == nullptr) { return; }
+        wakeChunk(x, y);
+        rehashTile(x, y, tileRef(x, y), type);
+        tileRef(x, y) = type;
+        touchChunk(x, y);
+        recordChange(x, y);
+        gridVersion++;
     }
 }
 
 void Simulation::setNextTile(int x, int y, TileType type) {
     if (isValidTile(x, y)) {
-        nextGrid[y][x] = type;
+        rehashTile(x, y, nextTileRef(x, y), type);
+        nextTileRef(x, y) = type;
+        touchChunk(x, y);
+        recordChange(x, y);
+    }
+}
+
+void Simulation::clear()
+{
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (getTile(x, y) != TILE_EMPTY) { setTile(x, y, TILE_EMPTY); }
+        }
     }
 }
 
 void Simulation::swapTiles(int x1, int y1, int x2, int y2){
-	TileType temp = nextGrid[y1][x1];
-	nextGrid[y1][x1] = nextGrid[y2][x2];
-	nextGrid[y2][x2] = temp;
+	TileType& first = nextTileRef(x1, y1);
+	TileType& second = nextTileRef(x2, y2);
+	rehashTile(x1, y1, first, second);
+	rehashTile(x2, y2, second, first);
+	TileType temp = first;
+	first = second;
+	second = temp;
+	touchChunk(x1, y1);
+	touchChunk(x2, y2);
+	recordChange(x1, y1);
+	recordChange(x2, y2);
 }
 
 bool Simulation::moveTile(int tileX, int tileY, int moveX, int moveY)
+{
+    Tally tally;
+    tally.changes = &changedCells;
+    bool moved = moveTile(tileX, tileY, moveX, moveY, tally);
+    stateHash += tally.hash;
+    tickMoves += tally.moves;
+    return moved;
+}
+
+bool Simulation::moveTile(int tileX, int tileY, int moveX, int moveY, Tally& tally)
 {
     int newX = tileX + moveX;
     int newY = tileY + moveY;
     if (!isValidTile(newX, newY) || !isValidTile(tileX, tileY)) { return false; } // Tile is not valid
 
-    TileType tile = grid[tileY][tileX];
-    TileType targetTile = nextGrid[newY][newX];
+    Chunk* sourceChunk = chunkAt(tileX, tileY);
+    if (sourceChunk == nullptr) { return false; } // Sleeping chunk, source tile is empty
 
+    const int mask = SIMULATION_CHUNK_SIZE - 1;
+    const int next = front ^ 1;
+    TileType tile = sourceChunk->tiles[front][tileY & mask][tileX & mask];
     if (tile == TILE_EMPTY) { return false; } // Source tile is empty
+    if (sourceChunk->tiles[next][tileY & mask][tileX & mask] != tile) { return false; } // Sand from the stripe above already swapped in
+
+    Chunk* targetChunk = chunkAt(newX, newY);
+    TileType targetTile = targetChunk ? targetChunk->tiles[next][newY & mask][newX & mask] : TILE_EMPTY;
 
     switch (tile)
     {
     case TILE_SAND: // Sand Movement
         switch (targetTile)
         {
-
         case TILE_EMPTY: // SAND X AIR
-            swapTiles(tileX, tileY, newX, newY);
-            return true;
         case TILE_WATER: // SAND X WATER
-            swapTiles(tileX, tileY, newX, newY);
-            return true;
+            break;
 
         default: return false;
         }
+        break;
     case TILE_WATER:
         switch (targetTile)
         {
         case TILE_EMPTY:
-            swapTiles(tileX, tileY, newX, newY);
-            return true;
+            break;
         default: return false;
         }
+        break;
 
     default: return false;
     }
 
+    // Swap in the next grid, waking the target chunk if it was asleep
+    if (targetChunk == nullptr) { targetChunk = wakeChunk(newX, newY); }
+    TileType& first = sourceChunk->tiles[next][tileY & mask][tileX & mask];
+    TileType& second = targetChunk->tiles[next][newY & mask][newX & mask];
+    if (stateHashing) { tally.hash += (TYPE_KEYS[second] - TYPE_KEYS[first]) * (cellKey(tileX, tileY) - cellKey(newX, newY)); }
+    TileType temp = first;
+    first = second;
+    second = temp;
+    touchChunk(tileX, tileY);
+    touchChunk(newX, newY);
+    recordChange(tileX, tileY, *tally.changes);
+    recordChange(newX, newY, *tally.changes);
+    tally.moves++;
+    return true;
+}
+
+int Simulation::calculateInstanceData(glm::vec2* positions, TileType* types, const ChunkRange& range) {
+    PROFILE_ZONE("instance data");
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_INSTANCE_DATA);
+
+    int count = 0;
+
+    // Populate instance data based on the grid, sleeping chunks have nothing to draw
+    int endY = std::min((range.maxY + 1) << SIMULATION_CHUNK_SHIFT, height);
+    for (int y = range.minY << SIMULATION_CHUNK_SHIFT; y < endY; ++y) {
+        for (int cx = range.minX; cx <= range.maxX; ++cx) {
+            Chunk* chunk = chunks[(y >> SIMULATION_CHUNK_SHIFT) * chunksX + cx];
+            if (chunk == nullptr) { continue; }
+
+            const TileType* row = chunk->tiles[front][y & (SIMULATION_CHUNK_SIZE - 1)];
+            int startX = cx << SIMULATION_CHUNK_SHIFT;
+            int endX = std::min(startX + SIMULATION_CHUNK_SIZE, width);
+
+            for (int x = startX; x < endX; ++x) {
+                TileType tile = row[x - startX];
+                if (tile != TILE_EMPTY) {
+                    float worldX = (x * cellSize) - 1.0f + (cellSize / 2.0f);
+                    float worldY = 1.0f - (y * cellSize) - (cellSize / 2.0f);
+
+                    positions[count] = glm::vec2(worldX, worldY);
+                    types[count] = tile;
+                    count++;
+                }
+            }
+        }
+    }
+
+    instanceCount = count;
+    return count;
+}
+
+int Simulation::calculateRunInstanceData(uint32_t* runs, const ChunkRange& range) {
+    PROFILE_ZONE("instance data");
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_INSTANCE_DATA);
+
+    int count = 0;
+
+    // Horizontal runs of one material become a single instance, runs continue across chunk borders
+    int endX = std::min((range.maxX + 1) << SIMULATION_CHUNK_SHIFT, width);
+    int endY = std::min((range.maxY + 1) << SIMULATION_CHUNK_SHIFT, height);
+    for (int y = range.minY << SIMULATION_CHUNK_SHIFT; y < endY; ++y) {
+        TileType runType = TILE_EMPTY;
+        int runStart = 0;
+
+        for (int cx = range.minX; cx <= range.maxX; ++cx) {
+            int startX = cx << SIMULATION_CHUNK_SHIFT;
+            int chunkEndX = std::min(startX + SIMULATION_CHUNK_SIZE, width);
+
+            Chunk* chunk = chunks[(y >> SIMULATION_CHUNK_SHIFT) * chunksX + cx];
+            if (chunk == nullptr) {
+                if (runType != TILE_EMPTY) {
+                    runs[count * 2] = packInstance(runStart, y, runType);
+                    runs[count * 2 + 1] = startX - runStart;
+                    ++count;
+                    runType = TILE_EMPTY;
+                }
+                continue;
+            }
+
+            const TileType* row = chunk->tiles[front][y & (SIMULATION_CHUNK_SIZE - 1)];
+
+            for (int x = startX; x < chunkEndX; ++x) {
+                TileType tile = row[x - startX];
+                if (tile == runType) { continue; }
+
+                if (runType != TILE_EMPTY) {
+                    runs[count * 2] = packInstance(runStart, y, runType);
+                    runs[count * 2 + 1] = x - runStart;
+                    ++count;
+                }
+                runType = tile;
+                runStart = x;
+            }
+        }
+
+        if (runType != TILE_EMPTY) {
+            runs[count * 2] = packInstance(runStart, y, runType);
+            runs[count * 2 + 1] = endX - runStart;
+            ++count;
+        }
+    }
+
+    instanceCount = count;
+    return count;
 }
 
-void Simulation::calculateInstanceData() {
+int Simulation::calculatePackedInstanceData(uint32_t* instances, const ChunkRange& range) {
+    PROFILE_ZONE("instance data");
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_INSTANCE_DATA);
 
-    // Clear previous data
-    cellPositions.clear();
-    cellTypes.clear();
+    int count = 0;
 
-    // Populate instance data based on the grid
-    for (int y = 0; y < SIMULATION_GRID_HEIGHT; ++y) {
-        for (int x = 0; x < SIMULATION_GRID_WIDTH; ++x) {
-            if (grid[y][x] != TILE_EMPTY) {
-                float worldX = (x * cellSize) - 1.0f + (cellSize / 2.0f);
-                float worldY = 1.0f - (y * cellSize) - (cellSize / 2.0f);
+    // Same walk as calculateInstanceData, positions are left for the vertex shader
+    int endY = std::min((range.maxY + 1) << SIMULATION_CHUNK_SHIFT, height);
+    for (int y = range.minY << SIMULATION_CHUNK_SHIFT; y < endY; ++y) {
+        for (int cx = range.minX; cx <= range.maxX; ++cx) {
+            Chunk* chunk = chunks[(y >> SIMULATION_CHUNK_SHIFT) * chunksX + cx];
+            if (chunk == nullptr) { continue; }
 
-                cellPositions.push_back(glm::vec2(worldX, worldY));
-                cellTypes.push_back(grid[y][x]);
+            const TileType* row = chunk->tiles[front][y & (SIMULATION_CHUNK_SIZE - 1)];
+            int startX = cx << SIMULATION_CHUNK_SHIFT;
+            int endX = std::min(startX + SIMULATION_CHUNK_SIZE, width);
+
+            for (int x = startX; x < endX; ++x) {
+                TileType tile = row[x - startX];
+                if (tile != TILE_EMPTY) {
+                    instances[count++] = packInstance(x, y, tile);
+                }
             }
         }
     }
 
-    instanceCount = cellPositions.size();
+    instanceCount = count;
+    return count;
 }
 
 void Simulation::simulateGrid()
 {
     if (isSimulationFrame(frameCounter))
     {
-        // Copy the grid
-        for (int y = 0; y < SIMULATION_GRID_HEIGHT; ++y) {
-            for (int x = 0; x < SIMULATION_GRID_WIDTH; ++x) {
-                nextGrid[y][x] = grid[y][x];
-            }
+        step();
+    }
+}
+
+void Simulation::step()
+{
+    PROFILE_ZONE("simulation");
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_SIMULATION);
+    if (perfCounters != nullptr) { perfCounters->begin(); }
+
+    tickMoves = 0;
+    tickCount++;
+
+    // Copy the grid
+    for (Chunk* chunk : chunks) {
+        if (chunk != nullptr) {
+            std::memcpy(chunk->tiles[front ^ 1], chunk->tiles[front], sizeof(chunk->tiles[front]));
         }
+    }
+
+    if (engine == ENGINE_STRIPED) { stepStripes(); }
+    else {
+        Tally tally;
+        tally.changes = &changedCells;
+        stepRows(0, height - 1, tally);
+        stateHash += tally.hash;
+        tickMoves += tally.moves;
+    }
 
-        // Bottom Left - > Top Right loop
-        for (int y = SIMULATION_GRID_HEIGHT - 1; y >= 0; --y) {
-            for (int x = 0; x < SIMULATION_GRID_WIDTH; ++x) {
+    // Swap grids
+    front ^= 1;
+    sleepEmptyChunks();
+    if (tickMoves > 0) { gridVersion++; }
+    PROFILE_COUNTER("awake chunks", chunkAllocator.getStats().liveBlocks);
 
-                TileType currentTile = grid[y][x];
+    // Water at rest on a ledge keeps stepping sideways and back, which never ends in a tick without moves
+    bool repeats = (tickMoves == 0);
+    for (int i = 0; i < hashedTicks; ++i) { repeats = repeats || (tickHashes[i] == stateHash); }
+    if (repeats) { settledVersion = gridVersion; }
+    if (stateHashing) {
+        std::memmove(tickHashes + 1, tickHashes, sizeof(tickHashes) - sizeof(tickHashes[0]));
+        tickHashes[0] = stateHash;
+        hashedTicks = std::min(hashedTicks + 1, SIMULATION_SETTLE_PERIOD);
+    }
+
+    // Back on only at half the limit, so a tick count near it doesn't recompute the hash every other tick
+    if (hashingMode == HASHING_SETTLING) {
+        int limit = width * height / SIMULATION_HASH_MOVE_FRACTION;
+        enableStateHashing(tickMoves <= (stateHashing ? limit : limit / 2));
+    }
+    if (perfCounters != nullptr) { perfCounters->end(); }
+}
 
-                switch (grid[y][x]) {
+void Simulation::stepRows(int firstY, int lastY, Tally& tally)
+{
+    // Bottom Left - > Top Right loop
+    for (int y = lastY; y >= firstY; --y) {
+        for (int cx = 0; cx < chunksX; ++cx) {
+            Chunk* chunk = chunks[(y >> SIMULATION_CHUNK_SHIFT) * chunksX + cx];
+            if (chunk == nullptr) { continue; } // Sleeping chunk
+
+            const TileType* row = chunk->tiles[front][y & (SIMULATION_CHUNK_SIZE - 1)];
+            int startX = cx << SIMULATION_CHUNK_SHIFT;
+            int endX = std::min(startX + SIMULATION_CHUNK_SIZE, width);
+
+            for (int x = startX; x < endX; ++x) {
+                switch (row[x - startX]) {
 
                 case TILE_SAND:
-                    if (moveTile(x, y, 0, 1)) { break; } // Down
-                    else if (moveTile(x, y, -1, 1)) { break; } // Down - Left
-                    else if (moveTile(x, y, 1, 1)) { break; } // Down - Right
+                    if (moveTile(x, y, 0, 1, tally)) { break; } // Down
+                    else if (moveTile(x, y, -1, 1, tally)) { break; } // Down - Left
+                    else if (moveTile(x, y, 1, 1, tally)) { break; } // Down - Right
                     break;
 
                 case TILE_WATER:
-                    if (moveTile(x, y, 0, 1)) { break; } // Down
-                    else if (moveTile(x, y, -1, 1)) { break; } // Down - Left
-                    else if (moveTile(x, y, 1, 1)) { break; } // Down - Right
+                    if (moveTile(x, y, 0, 1, tally)) { break; } // Down
+                    else if (moveTile(x, y, -1, 1, tally)) { break; } // Down - Left
+                    else if (moveTile(x, y, 1, 1, tally)) { break; } // Down - Right
 
-                    else if (moveTile(x, y, -4, 0)) { break; } // Left
-                    else if (moveTile(x, y, 4, 0)) { break; } // Right
+                    else if (moveTile(x, y, -4, 0, tally)) { break; } // Left
+                    else if (moveTile(x, y, 4, 0, tally)) { break; } // Right
                     break;
+
+                default: break; // Air and stone stay put
                 }
             }
         }
-        // Swap grids
-        std::swap(grid, nextGrid);
     }
-}
\ No newline at end of file
+}
+
+void Simulation::stepStripes()
+{
+    // Stripes two apart never reach the same cells: one writes its rows and the top row below it
+    int bottom = chunksY - 1;
+    std::function<void(int, int)> body = [this, &bottom](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            int stripe = bottom - 2 * i;
+            Tally& tally = stripeTallies[stripe];
+            tally.changes = &stripeChanges[stripe];
+            int firstY = stripe << SIMULATION_CHUNK_SHIFT;
+            stepRows(firstY, std::min(firstY + SIMULATION_CHUNK_SIZE, height) - 1, tally);
+        }
+    };
+    for (int pass = 0; pass < 2; ++pass, --bottom) {
+        int count = (bottom + 2) / 2;
+        if (pool != nullptr) { pool->parallelFor(count, body); }
+        else { body(0, count); }
+    }
+
+    // Folded in stripe order so the change list is the same on every thread count
+    for (int stripe = 0; stripe < chunksY; ++stripe) {
+        Tally& tally = stripeTallies[stripe];
+        stateHash += tally.hash;
+        tickMoves += tally.moves;
+        changedCells.insert(changedCells.end(), stripeChanges[stripe].begin(), stripeChanges[stripe].end());
+        stripeChanges[stripe].clear();
+        tally = Tally();
+    }
+}
@@ -1,42 +1,201 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <glm/glm.hpp>
 #include "FrameCounter.h"
-#include <string>
+#include "ChunkAllocator.h"
+
+class PerfCounters;
+class ThreadPool;
 
 class Simulation
 {
 public:
-	enum TileType {
+	enum TileType : uint8_t {
 		TILE_EMPTY = 0,
 		TILE_SAND = 1,
-		TILE_WATER = 2
+		TILE_WATER = 2,
+		TILE_STONE = 3 // Never moves, walls and obstacles
+	};
+	static const int TILE_TYPE_COUNT = 4;
+
+	// Material definitions, renderers build their palettes from these
+	struct Material {
+		const char* name;
+		float color[3];
+		float variation; // Per-grain brightness spread, 0 for a flat colour
 	};
+	static const Material MATERIALS[TILE_TYPE_COUNT];
+	static const int MAX_MATERIALS = 64; // Material bits in a packed instance
+
+	// RGBA8 texel per material: colour in rgb, grain spread in alpha. Shared by the GL and software renderers.
+	static void buildPalette(uint8_t palette[MAX_MATERIALS * 4]);
+
+	Simulation(int width = SIMULATION_GRID_WIDTH, int height = SIMULATION_GRID_HEIGHT);
+	~Simulation();
 
 	void update();
-	void calculateInstanceData();
+	void step(); // One simulation tick, update() calls it every SIMULATION_INTERVAL_IN_FRAMES frames
+
+	// How step() walks the grid. The serial engine sweeps every row bottom to top. The striped one
+	// steps each chunk row as a stripe, in two passes of every other stripe, the bottom one first;
+	// stripes in a pass touch disjoint cells, so they run on the pool in any order and the result
+	// doesn't depend on the thread count. Grains crossing a stripe border can move differently
+	// from the serial sweep, where the stripe above went first.
+	enum Engine {
+		ENGINE_SERIAL = 0,
+		ENGINE_STRIPED,
+		ENGINE_COUNT
+	};
+	static const char* const ENGINE_NAMES[ENGINE_COUNT];
+	void setEngine(Engine engine, ThreadPool* pool = nullptr); // Without a pool the stripes run on the calling thread
+	Engine getEngine() { return engine; }
+	// Stripes one pass of the striped engine steps at once, workers beyond that have nothing to do
+	static int getStripesPerPass(int height) { return (((height + SIMULATION_CHUNK_SIZE - 1) >> SIMULATION_CHUNK_SHIFT) + 1) / 2; }
+	// Inclusive rectangle of chunk coordinates
+	struct ChunkRange {
+		int minX, minY, maxX, maxY;
+		bool operator==(const ChunkRange& other) const { return minX == other.minX && minY == other.minY && maxX == other.maxX && maxY == other.maxY; }
+		bool operator!=(const ChunkRange& other) const { return !(*this == other); }
+	};
+	ChunkRange getAllChunks() { return { 0, 0, chunksX - 1, chunksY - 1 }; }
+
+	// Instance builders only walk the chunks inside the range
+	int calculateInstanceData(glm::vec2* positions, TileType* types, const ChunkRange& range); // Both need room for width * height entries
+	int calculateInstanceData(glm::vec2* positions, TileType* types) { return calculateInstanceData(positions, types, getAllChunks()); }
+	int calculatePackedInstanceData(uint32_t* instances, const ChunkRange& range);
+	int calculatePackedInstanceData(uint32_t* instances) { return calculatePackedInstanceData(instances, getAllChunks()); }
+	int calculateRunInstanceData(uint32_t* runs, const ChunkRange& range); // Packed start cell and length per run, needs room for 2 * width * height entries
+	int calculateRunInstanceData(uint32_t* runs) { return calculateRunInstanceData(runs, getAllChunks()); }
+
+	// Packed instance: grid x in bits 0-12, grid y in bits 13-25, material in bits 26-31
+	static const int PACKED_COORD_BITS = 13;
+	static uint32_t packInstance(int x, int y, TileType type) { return (uint32_t)x | ((uint32_t)y << PACKED_COORD_BITS) | ((uint32_t)type << (2 * PACKED_COORD_BITS)); }
+
+	// Stable per-cell hash behind the grain variation, same as grainHash in palettefs.glsl
+	static uint32_t grainHash(int x, int y) {
+		uint32_t h = (uint32_t)x | ((uint32_t)y << 16);
+		h ^= h >> 16; h *= 0x7feb352du; h ^= h >> 15; h *= 0x846ca68bu; h ^= h >> 16;
+		return h;
+	}
+
 	bool isSimulationFrame(FrameCounter* frameCounter);
-	bool isValidTile(int x, int y);
+	bool isValidTile(int x, int y) { return (x >= 0 && x < width && y >= 0 && y < height); }
 	bool moveTile(int tileX, int tileY, int moveX, int moveY);
 	void swapTiles(int x1, int y1, int x2, int y2);
-	std::string getTileName(TileType type);
+	const char* getTileName(TileType type);
 	int getInstanceCount() { return instanceCount; }
 	float getCellSize() { return cellSize; }
-	std::vector<glm::vec2> getCellPositions() { return cellPositions; }
-	std::vector<TileType> getCellTypes() { return cellTypes; }
+	int getWidth() { return width; }
+	int getHeight() { return height; }
+	TileType getTile(int x, int y) { return (isValidTile(x, y) && chunkAt(x, y) != nullptr) ? tileRef(x, y) : TILE_EMPTY; }
 	void setTile(int x, int y, TileType type);
 	void setNextTile(int x, int y, TileType type);
+	void clear(); // Every tile back to air, through setTile so change tracking sees it
+	ChunkAllocator::Stats getChunkStats() { return chunkAllocator.getStats(); }
+
+	// Chunk level access for renderers, a chunk's version changes whenever one of its tiles does
+	int getChunksX() { return chunksX; }
+	int getChunksY() { return chunksY; }
+	const TileType* getChunkTiles(int chunkX, int chunkY); // Row-major SIMULATION_CHUNK_SIZE^2 tiles, nullptr if asleep
+	uint32_t getChunkVersion(int chunkX, int chunkY) { return chunkVersions[chunkY * chunksX + chunkX]; }
+	uint32_t getGridVersion() { return gridVersion; }
+	int getLastTickMoves() { return tickMoves; }
+	// Order-independent hash of every cell, kept current by tile writes, so reading it per tick is free.
+	// A chunk's hash sums its cells the same way and is computed on demand; all chunks add up to the grid's.
+	uint64_t getStateHash() { return stateHash; }
+	uint64_t getChunkHash(int chunkX, int chunkY);
+	// When tile writes keep the hash current. Only settle detection reads it outside the determinism
+	// check, and a grid can't be settling while a tick moves more than 1/SIMULATION_HASH_MOVE_FRACTION of
+	// its cells, so by default those ticks skip the upkeep. getStateHash() is stale meanwhile and only
+	// ticks without moves settle the grid; turning it back on recomputes the hash from the chunks.
+	enum StateHashing {
+		HASHING_SETTLING = 0,
+		HASHING_ALWAYS,
+		HASHING_OFF
+	};
+	void setStateHashing(StateHashing mode);
+	uint32_t getTickCount() { return tickCount; }
+	void setPerfCounters(PerfCounters* counters) { perfCounters = counters; } // Wrapped around every step(), nullptr to stop
+	// Nothing was placed since a tick that moved nothing or that brought the grid back to an earlier
+	// tick's state. Ticks are deterministic, so further ones would only repeat the same few frames.
+	bool isSettled() { return settledVersion == gridVersion; }
+
+	// Cells written since the last clearChanges(), each listed once (only recorded while tracking is on)
+	void setChangeTracking(bool enabled);
+	const int* getChangedCells() { return changedCells.data(); }
+	int getChangedCount() { return (int)changedCells.size(); }
+	void clearChanges();
 	double getFPS();
 
 private:
-	TileType grid[SIMULATION_GRID_HEIGHT][SIMULATION_GRID_WIDTH] = { TILE_EMPTY };
-	TileType nextGrid[SIMULATION_GRID_HEIGHT][SIMULATION_GRID_WIDTH] = { TILE_EMPTY };
-	float cellSize = 2.0f / std::max(SIMULATION_GRID_WIDTH, SIMULATION_GRID_HEIGHT);
-	std::vector<glm::vec2> cellPositions;
-	std::vector<TileType> cellTypes;
+	// Both generations of a chunk live in the same block, 'front' picks the current one
+	struct Chunk {
+		TileType tiles[2][SIMULATION_CHUNK_SIZE][SIMULATION_CHUNK_SIZE];
+	};
+
+	int width;
+	int height;
+	int chunksX;
+	int chunksY;
+	std::vector<Chunk*> chunks; // nullptr = sleeping chunk, all air
+	std::vector<uint32_t> chunkVersions;
+	uint32_t gridVersion = 0;
+	uint32_t settledVersion = 0; // gridVersion as of the last tick that settled the grid
+	uint64_t stateHash = 0; // Sum of cellHash over all cells, every tile write keeps it current while stateHashing
+	StateHashing hashingMode = HASHING_SETTLING;
+	bool stateHashing = true; // Whether the current tick keeps stateHash up
+	int hashedTicks = 0; // Entries of tickHashes taken with stateHashing on, reset when it turns off
+	std::vector<uint64_t> rowKeys, columnKeys; // Random per row and column, see cellHash
+	uint64_t tickHashes[SIMULATION_SETTLE_PERIOD] = {}; // stateHash after each of the last ticks, newest first
+	int tickMoves = 0; // Tiles moved by the current/last simulation tick
+	uint32_t tickCount = 0;
+	bool changeTracking = false;
+	std::vector<uint8_t> changedFlags;
+	std::vector<int> changedCells;
+	int front = 0;
+	ChunkAllocator chunkAllocator;
+	PerfCounters* perfCounters = nullptr;
+	Engine engine = ENGINE_SERIAL;
+	ThreadPool* pool = nullptr;
+
+	// What one run of stepRows() changed, added to the grid totals once the tick is done
+	struct Tally {
+		uint64_t hash = 0; // Change of stateHash, wraps the same way
+		int moves = 0;
+		std::vector<int>* changes = nullptr; // Cells to list while change tracking is on
+	};
+	std::vector<Tally> stripeTallies; // One per chunk row for the striped engine
+	std::vector<std::vector<int>> stripeChanges;
+
+	float cellSize;
 	int instanceCount = 0;
 
 	void simulateGrid();
+	void stepRows(int firstY, int lastY, Tally& tally); // Bottom to top, reads front and writes next
+	void stepStripes();
+	bool moveTile(int tileX, int tileY, int moveX, int moveY, Tally& tally);
+	void reserveStripeChanges();
+	Chunk*& chunkAt(int x, int y) { return chunks[(y >> SIMULATION_CHUNK_SHIFT) * chunksX + (x >> SIMULATION_CHUNK_SHIFT)]; }
+	Chunk* wakeChunk(int x, int y);
+	TileType getNextTile(int x, int y) { Chunk* chunk = chunkAt(x, y); return chunk ? chunk->tiles[front ^ 1][y & (SIMULATION_CHUNK_SIZE - 1)][x & (SIMULATION_CHUNK_SIZE - 1)] : TILE_EMPTY; }
+	void sleepEmptyChunks();
+	void enableStateHashing(bool enabled); // Turning it on recomputes stateHash from the chunks
+	// A cell hashes to its type's key times its cell key, air to 0. Swapping two cells then changes the
+	// sum by a single product, (TYPE_KEYS[b] - TYPE_KEYS[a]) * (cellKey(p) - cellKey(q)), and the keys
+	// are two lookups instead of a hash of the position per cell.
+	static const uint64_t TYPE_KEYS[TILE_TYPE_COUNT];
+	uint64_t cellKey(int x, int y) { return rowKeys[y] ^ columnKeys[x]; }
+	uint64_t cellHash(int x, int y, TileType type) { return TYPE_KEYS[type] * cellKey(x, y); }
+	void rehashTile(int x, int y, TileType from, TileType to) { if (stateHashing) { stateHash += (TYPE_KEYS[to] - TYPE_KEYS[from]) * cellKey(x, y); } }
+	void touchChunk(int x, int y) { chunkVersions[(y >> SIMULATION_CHUNK_SHIFT) * chunksX + (x >> SIMULATION_CHUNK_SHIFT)]++; }
+	void recordChange(int x, int y) { recordChange(x, y, changedCells); }
+	void recordChange(int x, int y, std::vector<int>& changes)
+	{
+		int cell = y * width + x;
+		if (changeTracking && !changedFlags[cell]) { changedFlags[cell] = 1; changes.push_back(cell); }
+	}
+	TileType& tileRef(int x, int y) { return chunkAt(x, y)->tiles[front][y & (SIMULATION_CHUNK_SIZE - 1)][x & (SIMULATION_CHUNK_SIZE - 1)]; }
+	TileType& nextTileRef(int x, int y) { return wakeChunk(x, y)->tiles[front ^ 1][y & (SIMULATION_CHUNK_SIZE - 1)][x & (SIMULATION_CHUNK_SIZE - 1)]; }
 };
-
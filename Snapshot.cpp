@@ -0,0 +1,108 @@
+#define _CRT_SECURE_NO_WARNINGS // fopen
+#include "Snapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    const char MAGIC[4] = { 'S', 'B', 'O', 'X' };
+    const uint32_t VERSION = 1;
+    const size_t HEADER_SIZE = 16;
+    const size_t CHUNK_TILES = SIMULATION_CHUNK_SIZE * SIMULATION_CHUNK_SIZE;
+
+    void putU32(uint8_t* out, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i) { out[i] = (uint8_t)(value >> (8 * i)); }
+    }
+
+    uint32_t getU32(const uint8_t* in)
+    {
+        return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+    }
+}
+
+void Snapshot::write(Simulation& sim, std::vector<uint8_t>& out)
+{
+    out.clear();
+    out.resize(HEADER_SIZE);
+
+    std::memcpy(&out[0], MAGIC, sizeof(MAGIC));
+    putU32(&out[4], VERSION);
+    putU32(&out[8], (uint32_t)sim.getWidth());
+    putU32(&out[12], (uint32_t)sim.getHeight());
+
+    for (int chunkY = 0; chunkY < sim.getChunksY(); ++chunkY) {
+        for (int chunkX = 0; chunkX < sim.getChunksX(); ++chunkX) {
+            const Simulation::TileType* tiles = sim.getChunkTiles(chunkX, chunkY);
+            out.push_back(tiles != nullptr);
+            if (tiles != nullptr) { out.insert(out.end(), (const uint8_t*)tiles, (const uint8_t*)tiles + CHUNK_TILES); }
+        }
+    }
+}
+
+bool Snapshot::read(Simulation& sim, const uint8_t* data, size_t size)
+{
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || getU32(data + 4) != VERSION) { return false; }
+    if (getU32(data + 8) != (uint32_t)sim.getWidth() || getU32(data + 12) != (uint32_t)sim.getHeight()) { return false; }
+
+    // Validate everything before touching the grid
+    size_t offset = HEADER_SIZE;
+    for (int chunk = 0; chunk < sim.getChunksX() * sim.getChunksY(); ++chunk) {
+        if (offset >= size || data[offset] > 1) { return false; }
+        bool awake = data[offset++] != 0;
+        if (!awake) { continue; }
+        if (size - offset < CHUNK_TILES) { return false; }
+        for (size_t i = 0; i < CHUNK_TILES; ++i) {
+            if (data[offset + i] >= Simulation::TILE_TYPE_COUNT) { return false; }
+        }
+        offset += CHUNK_TILES;
+    }
+    if (offset != size) { return false; }
+
+    // Only cells that differ are written, so change tracking and chunk versions see the real edit
+    offset = HEADER_SIZE;
+    for (int chunkY = 0; chunkY < sim.getChunksY(); ++chunkY) {
+        for (int chunkX = 0; chunkX < sim.getChunksX(); ++chunkX) {
+            const uint8_t* tiles = data[offset++] ? data + offset : nullptr;
+            if (tiles != nullptr) { offset += CHUNK_TILES; }
+            if (tiles == nullptr && sim.getChunkTiles(chunkX, chunkY) == nullptr) { continue; }
+
+            int startX = chunkX * SIMULATION_CHUNK_SIZE, startY = chunkY * SIMULATION_CHUNK_SIZE;
+            int endX = std::min(startX + SIMULATION_CHUNK_SIZE, sim.getWidth());
+            int endY = std::min(startY + SIMULATION_CHUNK_SIZE, sim.getHeight());
+            for (int y = startY; y < endY; ++y) {
+                for (int x = startX; x < endX; ++x) {
+                    Simulation::TileType type = tiles ? (Simulation::TileType)tiles[(y - startY) * SIMULATION_CHUNK_SIZE + (x - startX)] : Simulation::TILE_EMPTY;
+                    if (sim.getTile(x, y) != type) { sim.setTile(x, y, type); }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool Snapshot::save(Simulation& sim, const char* path)
+{
+    std::vector<uint8_t> data;
+    write(sim, data);
+
+    FILE* file = std::fopen(path, "wb");
+    if (file == nullptr) { return false; }
+    bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return (std::fclose(file) == 0) && ok;
+}
+
+bool Snapshot::load(Simulation& sim, const char* path)
+{
+    FILE* file = std::fopen(path, "rb");
+    if (file == nullptr) { return false; }
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[64 * 1024];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) { data.insert(data.end(), buffer, buffer + count); }
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+    return ok && read(sim, data.data(), data.size());
+}
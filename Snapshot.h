@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Simulation.h"
+
+// Binary copy of the grid: a header (magic, version, width, height), then one byte per chunk
+// telling whether it is awake, each awake chunk followed by its SIMULATION_CHUNK_SIZE^2 tiles.
+// Sleeping chunks are all air and cost that one byte. Only grids of the same size load.
+class Snapshot
+{
+public:
+	static void write(Simulation& sim, std::vector<uint8_t>& out); // Replaces the contents of out
+	static bool read(Simulation& sim, const uint8_t* data, size_t size); // False if malformed, the grid is left as it was
+
+	static bool save(Simulation& sim, const char* path);
+	static bool load(Simulation& sim, const char* path);
+};
@@ -0,0 +1,162 @@
+#include "SoftwareRenderer.h"
+#include "Config.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_RENDERER_SSE2
+#endif
+
+static uint32_t packColor(int r, int g, int b, int a)
+{
+    return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+static int toByte(float value)
+{
+    // Round half to even like the GL unorm conversion, 0.3 -> 76
+    return (int)std::lrint(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+}
+
+SoftwareRenderer::SoftwareRenderer(Simulation* sim, ThreadPool* pool, int width, int height, Camera* camera)
+{
+    _sim = sim;
+    _pool = pool;
+    _camera = camera;
+    _width = width;
+    _height = height;
+
+    MemoryTracker::Scope memoryScope(MemoryTracker::TAG_INSTANCE_DATA);
+    _pixels.assign((size_t)width * height, 0);
+
+    Simulation::buildPalette(_palette);
+    _clearColor = packColor(toByte(CLEAR_COLOR[0]), toByte(CLEAR_COLOR[1]), toByte(CLEAR_COLOR[2]), toByte(CLEAR_COLOR[3]));
+
+    _cellColors.assign((size_t)(sim->getWidth() + 1) * sim->getHeight(), _clearColor);
+    _cachedVersions.assign(sim->getChunksX() * sim->getChunksY(), 0);
+    _rowCells.resize(height);
+}
+
+void SoftwareRenderer::render()
+{
+    updateCellColors();
+    updateSpans();
+
+    // Bands of rows per thread, a row repeating the cell row above is copied
+    _pool->parallelFor(_height, [this](int begin, int end) { renderRows(begin, end); });
+}
+
+uint32_t SoftwareRenderer::shadeCell(Simulation::TileType type, int x, int y)
+{
+    if (type == Simulation::TILE_EMPTY) { return _clearColor; }
+
+    // palettefs.glsl: rgb * (1 - spread + 2 * spread * grain)
+    const uint8_t* entry = &_palette[type * 4];
+    float spread = entry[3] / 255.0f;
+    float grain = (float)(Simulation::grainHash(x, y) & 0xFFFFu) / 65535.0f;
+    float factor = 1.0f - spread + 2.0f * spread * grain;
+
+    return packColor(toByte(entry[0] / 255.0f * factor), toByte(entry[1] / 255.0f * factor), toByte(entry[2] / 255.0f * factor), 255);
+}
+
+void SoftwareRenderer::updateCellColors()
+{
+    int chunksX = _sim->getChunksX();
+    int rowStride = _sim->getWidth() + 1;
+
+    _pool->parallelFor(_sim->getChunksY(), [this, chunksX, rowStride](int begin, int end) {
+        for (int chunkY = begin; chunkY < end; ++chunkY) {
+            for (int chunkX = 0; chunkX < chunksX; ++chunkX) {
+                uint32_t version = _sim->getChunkVersion(chunkX, chunkY);
+                uint32_t& cached = _cachedVersions[chunkY * chunksX + chunkX];
+                if (_cacheValid && cached == version) { continue; }
+                cached = version;
+
+                const Simulation::TileType* tiles = _sim->getChunkTiles(chunkX, chunkY);
+                int startX = chunkX * SIMULATION_CHUNK_SIZE;
+                int startY = chunkY * SIMULATION_CHUNK_SIZE;
+                int endX = std::min(startX + SIMULATION_CHUNK_SIZE, _sim->getWidth());
+                int endY = std::min(startY + SIMULATION_CHUNK_SIZE, _sim->getHeight());
+
+                for (int y = startY; y < endY; ++y) {
+                    uint32_t* colors = &_cellColors[(size_t)y * rowStride];
+                    const Simulation::TileType* row = tiles ? tiles + (y - startY) * SIMULATION_CHUNK_SIZE : nullptr;
+                    for (int x = startX; x < endX; ++x) {
+                        colors[x] = row ? shadeCell(row[x - startX], x, y) : _clearColor;
+                    }
+                }
+            }
+        }
+    });
+    _cacheValid = true;
+}
+
+void SoftwareRenderer::updateSpans()
+{
+    glm::vec2 center = _camera ? _camera->getCenter() : glm::vec2(0.0f);
+    float zoom = _camera ? _camera->getZoom() : 1.0f;
+    if (zoom == _spanZoom && center == _spanCenter) { return; }
+    _spanZoom = zoom;
+    _spanCenter = center;
+
+    // Pixel centre -> NDC -> world -> cell, the grid texture shader's mapping
+    float cellSize = _sim->getCellSize();
+    int gridWidth = _sim->getWidth();
+    _spans.clear();
+    for (int px = 0; px < _width; ++px) {
+        float ndcX = (px + 0.5f) / _width * 2.0f - 1.0f;
+        int cellX = (int)std::floor((ndcX / zoom + center.x + 1.0f) / cellSize);
+        int cell = (cellX >= 0 && cellX < gridWidth) ? cellX : gridWidth; // Spare clear entry
+
+        if (!_spans.empty() && _spans.back().cell == cell) {
+            _spans.back().end = px + 1;
+        }
+        else {
+            Span span = { cell, px, px + 1 };
+            _spans.push_back(span);
+        }
+    }
+
+    for (int py = 0; py < _height; ++py) {
+        float ndcY = 1.0f - (py + 0.5f) / _height * 2.0f;
+        int cellY = (int)std::floor((1.0f - (ndcY / zoom + center.y)) / cellSize);
+        _rowCells[py] = (cellY >= 0 && cellY < _sim->getHeight()) ? cellY : -1;
+    }
+}
+
+void SoftwareRenderer::renderRows(int begin, int end)
+{
+    int rowStride = _sim->getWidth() + 1;
+
+    for (int py = begin; py < end; ++py) {
+        uint32_t* out = &_pixels[(size_t)py * _width];
+
+        if (py > begin && _rowCells[py] == _rowCells[py - 1]) {
+            std::memcpy(out, out - _width, _width * sizeof(uint32_t));
+            continue;
+        }
+
+        if (_rowCells[py] < 0) {
+            std::fill(out, out + _width, _clearColor);
+            continue;
+        }
+
+        const uint32_t* colors = &_cellColors[(size_t)_rowCells[py] * rowStride];
+        for (const Span& span : _spans) {
+            uint32_t color = colors[span.cell];
+            int px = span.begin;
+#ifdef SOFTWARE_RENDERER_SSE2
+            __m128i fill = _mm_set1_epi32((int)color);
+            for (; px + 4 <= span.end; px += 4) {
+                _mm_storeu_si128((__m128i*)(out + px), fill);
+            }
+#endif
+            for (; px < span.end; ++px) {
+                out[px] = color;
+            }
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Simulation.h"
+#include "Camera.h"
+#include "ThreadPool.h"
+
+// Draws the grid into an RGBA8 framebuffer on the CPU, no GL context needed.
+// Matches the GL renderers: same palette, grain hash, camera mapping and clear colour.
+class SoftwareRenderer
+{
+public:
+	SoftwareRenderer(Simulation* sim, ThreadPool* pool, int width, int height, Camera* camera = nullptr);
+
+	void render();
+	const uint32_t* getPixels() { return _pixels.data(); } // Top row first, RGBA bytes in memory order
+	int getWidth() { return _width; }
+	int getHeight() { return _height; }
+
+private:
+	Simulation* _sim;
+	ThreadPool* _pool;
+	Camera* _camera;
+	int _width, _height;
+	std::vector<uint32_t> _pixels;
+
+	uint8_t _palette[Simulation::MAX_MATERIALS * 4]; // Same texels as the palette texture
+	uint32_t _clearColor;
+
+	// Shaded colour of every cell, one spare clear entry per row for columns outside the grid.
+	// Recomputed per chunk when its version moves.
+	std::vector<uint32_t> _cellColors;
+	std::vector<uint32_t> _cachedVersions;
+	bool _cacheValid = false;
+
+	// Pixel columns grouped into spans that show the same cell, rebuilt when the camera moves
+	struct Span {
+		int cell;
+		int begin, end;
+	};
+	std::vector<Span> _spans;
+	std::vector<int> _rowCells; // Cell row under each pixel row, -1 outside the grid
+	glm::vec2 _spanCenter;
+	float _spanZoom = 0.0f;
+
+	void updateCellColors();
+	void updateSpans();
+	void renderRows(int begin, int end);
+	uint32_t shadeCell(Simulation::TileType type, int x, int y);
+};
@@ -0,0 +1,92 @@
+#include "StreamingBuffer.h"
+
+StreamingBuffer::StreamingBuffer(GLenum target, size_t segmentSize)
+{
+    _target = target;
+    _segmentSize = (segmentSize + 255) & ~(size_t)255; // Keep segment starts aligned for any attribute type
+    _persistent = GLAD_GL_VERSION_4_4 && glBufferStorage != nullptr;
+
+    glGenBuffers(1, &_buffer);
+    glBindBuffer(_target, _buffer);
+
+    if (_persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(_target, _segmentSize * SEGMENT_COUNT, nullptr, flags);
+        _mapped = static_cast<char*>(glMapBufferRange(_target, 0, _segmentSize * SEGMENT_COUNT, flags));
+        _persistent = (_mapped != nullptr);
+
+        if (!_persistent) {
+            // Storage from glBufferStorage is immutable, the fallback needs a buffer of its own
+            glDeleteBuffers(1, &_buffer);
+            glGenBuffers(1, &_buffer);
+            glBindBuffer(_target, _buffer);
+        }
+    }
+
+    if (!_persistent) {
+        glBufferData(_target, _segmentSize, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+    for (GLsync& fence : _fences) {
+        if (fence) { glDeleteSync(fence); }
+    }
+
+    if (_mapped) {
+        glBindBuffer(_target, _buffer);
+        glUnmapBuffer(_target);
+    }
+    glDeleteBuffers(1, &_buffer);
+}
+
+void* StreamingBuffer::beginWrite()
+{
+    glBindBuffer(_target, _buffer);
+
+    if (_persistent) {
+        _segment = (_segment + 1) % SEGMENT_COUNT;
+        waitForSegment(_segment);
+        return _mapped + _segment * _segmentSize;
+    }
+
+    // Orphan the old storage so the driver can hand out fresh memory without a sync
+    glBufferData(_target, _segmentSize, nullptr, GL_STREAM_DRAW);
+    _mapped = static_cast<char*>(glMapBufferRange(_target, 0, _segmentSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    return _mapped;
+}
+
+void StreamingBuffer::endWrite()
+{
+    if (!_persistent && _mapped) {
+        glBindBuffer(_target, _buffer);
+        glUnmapBuffer(_target);
+        _mapped = nullptr;
+    }
+}
+
+void StreamingBuffer::markInUse()
+{
+    if (!_persistent) { return; }
+
+    if (_fences[_segment]) { glDeleteSync(_fences[_segment]); }
+    _fences[_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamingBuffer::waitForSegment(int segment)
+{
+    GLsync& fence = _fences[segment];
+    if (!fence) { return; }
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        _stallCount++;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+// Buffer for data that is rewritten every time it changes (instance streams).
+// With GL 4.4 the storage is mapped once (persistent + coherent) and split into
+// three ring segments, each guarded by a fence so the CPU never overwrites data
+// the GPU is still reading. On GL 3.3 it falls back to orphaning the buffer and
+// writing through glMapBufferRange, as it does when the persistent mapping fails.
+class StreamingBuffer
+{
+public:
+	static const int SEGMENT_COUNT = 3;
+
+	StreamingBuffer(GLenum target, size_t segmentSize);
+	~StreamingBuffer();
+
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+	void* beginWrite();      // Mapped pointer to the next free segment, blocks only if the GPU is 3 frames behind
+	                         // nullptr if the driver could not map it, there is nothing to endWrite() then
+	void endWrite();
+	void markInUse();        // Call after each draw that reads the current segment
+
+	unsigned int getBuffer() { return _buffer; }
+	size_t getOffset() { return _persistent ? _segment * _segmentSize : 0; } // Of the last written segment
+	size_t getSegmentSize() { return _segmentSize; }
+	bool isPersistent() { return _persistent; }
+	int getStallCount() { return _stallCount; } // Writes that had to wait on a fence
+
+private:
+	GLenum _target;
+	unsigned int _buffer;
+	size_t _segmentSize;
+	bool _persistent;
+	char* _mapped = nullptr; // The whole storage when persistent, otherwise the segment between beginWrite and endWrite
+	int _segment = SEGMENT_COUNT - 1;
+	GLsync _fences[SEGMENT_COUNT] = {};
+	int _stallCount = 0;
+
+	void waitForSegment(int segment);
+};
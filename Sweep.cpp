@@ -0,0 +1,422 @@
+#define _CRT_SECURE_NO_WARNINGS // fopen for the reports
+#include "Sweep.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "CommandLine.h"
+#include "Config.h"
+#include "Simulation.h"
+#include "Scenario.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const SweepOptions::GridSize DEFAULT_GRIDS[] = { { 460, 460 }, { 1024, 1024 }, { 2048, 2048 }, { 4096, 4096 }, { 8192, 8192 } };
+    const double GRID_CLIFF_RATIO = 1.5; // ns per cell this many times the next smaller grid's
+    const double WORKER_CLIFF_GAIN = 1.1; // More workers that aren't at least this much faster
+    const char* const SERIES_COLORS[] = { "#1f77b4", "#ff7f0e", "#2ca02c", "#9467bd", "#8c564b", "#e377c2", "#17becf", "#bcbd22" };
+
+    struct Point
+    {
+        int scenario;
+        SweepOptions::GridSize grid;
+        Simulation::Engine engine;
+        int workers;
+        double seconds; // Timed ticks only, without the scenario sources
+        double ticksPerSecond;
+        double nsPerCell;
+        double awakeChunks; // Mean over the timed ticks
+        double chunkMB; // High water of the chunk allocator
+        double chunkGBps; // Both generations of every awake chunk, once per tick
+        double speedup = 0.0; // Against the striped engine on the fewest workers, NaN for the serial engine
+        double efficiency = 0.0; // Speedup per added worker, 1 when time shrinks by the worker ratio
+        bool gridCliff = false;
+        bool workerCliff = false;
+
+        double getCells() const { return (double)grid.width * grid.height; }
+        const char* getCliff() const { return gridCliff ? (workerCliff ? "grid+workers" : "grid") : (workerCliff ? "workers" : ""); }
+    };
+
+    // The striped engine runs on pool, nullptr for the serial engine
+    Point measure(int scenario, SweepOptions::GridSize grid, Simulation::Engine engine, ThreadPool* pool, const SweepOptions& options)
+    {
+        Simulation sim(grid.width, grid.height);
+        sim.setEngine(engine, pool);
+
+        Scenario workload((Scenario::Id)scenario);
+        workload.setUp(sim);
+        for (int tick = 0; tick < options.warmup; ++tick) {
+            workload.update(sim);
+            sim.step();
+        }
+
+        double seconds = 0.0, awake = 0.0;
+        for (int tick = 0; tick < options.ticks; ++tick) {
+            workload.update(sim);
+            Clock::time_point start = Clock::now();
+            sim.step();
+            seconds += std::chrono::duration<double>(Clock::now() - start).count();
+            awake += (double)sim.getChunkStats().liveBlocks;
+        }
+
+        ChunkAllocator::Stats stats = sim.getChunkStats();
+        Point point;
+        point.scenario = scenario;
+        point.grid = grid;
+        point.engine = engine;
+        point.workers = (pool != nullptr) ? pool->getThreadCount() : 1;
+        point.seconds = seconds;
+        point.ticksPerSecond = (seconds > 0.0) ? options.ticks / seconds : 0.0;
+        point.nsPerCell = seconds * 1e9 / ((double)options.ticks * point.getCells());
+        point.awakeChunks = awake / options.ticks;
+        point.chunkMB = stats.highWaterBytes / (1024.0 * 1024.0);
+        point.chunkGBps = point.awakeChunks * stats.blockSize * point.ticksPerSecond / 1e9;
+        sim.setEngine(engine, nullptr);
+        return point;
+    }
+
+    // Speedup, efficiency and the worker cliffs of one scenario on one grid, serial point first. The
+    // engines do different work at stripe borders, so the striped points only compare with each other.
+    void compareWorkers(std::vector<Point>& points, size_t first)
+    {
+        points[first].speedup = points[first].efficiency = std::nan("");
+        const Point* fewest = nullptr;
+        const Point* previous = nullptr;
+        for (size_t i = first + 1; i < points.size(); ++i) {
+            Point& point = points[i];
+            if (fewest == nullptr) { fewest = &point; }
+            point.speedup = fewest->seconds / point.seconds;
+            point.efficiency = point.speedup * fewest->workers / point.workers;
+            point.workerCliff = (previous != nullptr) && point.ticksPerSecond < previous->ticksPerSecond * WORKER_CLIFF_GAIN;
+            previous = &point;
+        }
+    }
+
+    // Blank for the serial engine
+    std::string formatRatio(double value, const char* format)
+    {
+        if (std::isnan(value)) { return ""; }
+        char text[32];
+        std::snprintf(text, sizeof(text), format, value);
+        return text;
+    }
+
+    // Grids are measured smallest first, so the same scenario, engine and workers on the previous grid came earlier
+    void findGridCliffs(std::vector<Point>& points)
+    {
+        for (size_t i = 0; i < points.size(); ++i) {
+            for (size_t j = i; j-- > 0;) {
+                const Point& smaller = points[j];
+                if (smaller.scenario != points[i].scenario || smaller.engine != points[i].engine || smaller.workers != points[i].workers) { continue; }
+                if (smaller.getCells() < points[i].getCells()) { points[i].gridCliff = points[i].nsPerCell > smaller.nsPerCell * GRID_CLIFF_RATIO; }
+                break;
+            }
+        }
+    }
+
+    bool writeCsv(const char* path, const SweepOptions& options, const std::vector<Point>& points)
+    {
+        FILE* file = std::fopen(path, "w");
+        if (file == nullptr) { return false; }
+
+        std::fprintf(file, "scenario,grid,cells,engine,workers,ticks,seconds,ticksPerSec,nsPerCell,awakeChunks,chunkMB,chunkGBps,speedup,efficiency,cliff\n");
+        for (const Point& point : points) {
+            std::fprintf(file, "%s,%dx%d,%.0f,%s,%d,%d,%.6f,%.3f,%.4f,%.1f,%.2f,%.3f,%s,%s,%s\n",
+                Scenario::NAMES[point.scenario], point.grid.width, point.grid.height, point.getCells(), Simulation::ENGINE_NAMES[point.engine],
+                point.workers, options.ticks, point.seconds, point.ticksPerSecond, point.nsPerCell, point.awakeChunks, point.chunkMB,
+                point.chunkGBps, formatRatio(point.speedup, "%.3f").c_str(), formatRatio(point.efficiency, "%.3f").c_str(), point.getCliff());
+        }
+
+        bool ok = !std::ferror(file);
+        std::fclose(file);
+        return ok;
+    }
+
+    // One line of a chart, NaN where a point is missing
+    struct Series
+    {
+        std::string name;
+        const char* color;
+        bool dashed;
+        std::vector<double> values;
+        std::vector<bool> cliffs;
+        std::vector<std::string> notes; // Hover text per point
+    };
+
+    void writeSvg(FILE* file, const char* title, const std::vector<std::string>& columns, const std::vector<Series>& series, double minTop)
+    {
+        const int WIDTH = 560, HEIGHT = 300, LEFT = 60, RIGHT = 130, TOP = 28, BOTTOM = 40;
+        int plotWidth = WIDTH - LEFT - RIGHT, plotHeight = HEIGHT - TOP - BOTTOM;
+
+        double top = minTop;
+        for (const Series& line : series) {
+            for (double value : line.values) { if (!std::isnan(value)) { top = std::max(top, value * 1.1); } }
+        }
+        if (top <= 0.0) { top = 1.0; }
+
+        auto columnX = [&](size_t column) { return LEFT + ((columns.size() > 1) ? plotWidth * (double)column / (columns.size() - 1) : plotWidth * 0.5); };
+        auto valueY = [&](double value) { return TOP + plotHeight * (1.0 - value / top); };
+
+        std::fprintf(file, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" font-size=\"11\">\n", WIDTH, HEIGHT);
+        std::fprintf(file, "<text x=\"%d\" y=\"16\" font-size=\"13\" font-weight=\"bold\">%s</text>\n", LEFT, title);
+        for (int tick = 0; tick <= 4; ++tick) {
+            double value = top * tick / 4.0;
+            std::fprintf(file, "<line x1=\"%d\" y1=\"%.1f\" x2=\"%d\" y2=\"%.1f\" stroke=\"#ddd\"/><text x=\"%d\" y=\"%.1f\" text-anchor=\"end\">%.3g</text>\n",
+                LEFT, valueY(value), LEFT + plotWidth, valueY(value), LEFT - 6, valueY(value) + 4, value);
+        }
+        for (size_t column = 0; column < columns.size(); ++column) {
+            std::fprintf(file, "<text x=\"%.1f\" y=\"%d\" text-anchor=\"middle\">%s</text>\n", columnX(column), TOP + plotHeight + 16, columns[column].c_str());
+        }
+
+        for (size_t index = 0; index < series.size(); ++index) {
+            const Series& line = series[index];
+            std::string path;
+            char segment[64];
+            bool pen = false;
+            for (size_t column = 0; column < line.values.size(); ++column) {
+                if (std::isnan(line.values[column])) { pen = false; continue; }
+                std::snprintf(segment, sizeof(segment), "%s%.1f %.1f ", pen ? "L" : "M", columnX(column), valueY(line.values[column]));
+                path += segment;
+                pen = true;
+            }
+            std::fprintf(file, "<path d=\"%s\" fill=\"none\" stroke=\"%s\" stroke-width=\"2\"%s/>\n", path.c_str(), line.color, line.dashed ? " stroke-dasharray=\"5 4\"" : "");
+
+            for (size_t column = 0; column < line.values.size(); ++column) {
+                if (std::isnan(line.values[column])) { continue; }
+                double x = columnX(column), y = valueY(line.values[column]);
+                const char* note = (column < line.notes.size()) ? line.notes[column].c_str() : "";
+                std::fprintf(file, "<circle cx=\"%.1f\" cy=\"%.1f\" r=\"3\" fill=\"%s\"><title>%s</title></circle>\n", x, y, line.color, note);
+                if (column < line.cliffs.size() && line.cliffs[column]) {
+                    std::fprintf(file, "<circle cx=\"%.1f\" cy=\"%.1f\" r=\"8\" fill=\"none\" stroke=\"#d62728\" stroke-width=\"2\"><title>%s</title></circle>\n", x, y, note);
+                }
+            }
+
+            int legendY = TOP + 14 * (int)index + 6;
+            std::fprintf(file, "<line x1=\"%d\" y1=\"%d\" x2=\"%d\" y2=\"%d\" stroke=\"%s\" stroke-width=\"2\"%s/><text x=\"%d\" y=\"%d\">%s</text>\n",
+                LEFT + plotWidth + 12, legendY, LEFT + plotWidth + 32, legendY, line.color, line.dashed ? " stroke-dasharray=\"5 4\"" : "",
+                LEFT + plotWidth + 36, legendY + 4, line.name.c_str());
+        }
+        std::fprintf(file, "</svg>\n");
+    }
+
+    const Point* findPoint(const std::vector<Point>& points, int scenario, const SweepOptions::GridSize& grid, Simulation::Engine engine, int workers)
+    {
+        for (const Point& point : points) {
+            if (point.scenario == scenario && point.grid.width == grid.width && point.grid.height == grid.height && point.engine == engine && point.workers == workers) { return &point; }
+        }
+        return nullptr;
+    }
+
+    std::string describe(const Point& point)
+    {
+        char text[256];
+        std::string scaling = std::isnan(point.speedup) ? std::string(", reference only")
+            : ", speedup " + formatRatio(point.speedup, "%.2f") + ", efficiency " + formatRatio(point.efficiency * 100.0, "%.0f%%");
+        std::snprintf(text, sizeof(text), "%s %dx%d %s x%d: %.1f ticks/s, %.3f ns/cell, %.1f MB chunks, %.2f GB/s%s%s%s",
+            Scenario::NAMES[point.scenario], point.grid.width, point.grid.height, Simulation::ENGINE_NAMES[point.engine], point.workers,
+            point.ticksPerSecond, point.nsPerCell, point.chunkMB, point.chunkGBps, scaling.c_str(),
+            point.getCliff()[0] ? ", cliff: " : "", point.getCliff());
+        return text;
+    }
+
+    bool writeChart(const char* path, const SweepOptions& options, const std::vector<Point>& points)
+    {
+        FILE* file = std::fopen(path, "w");
+        if (file == nullptr) { return false; }
+
+        std::fprintf(file, "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>Scaling sweep</title>\n"
+            "<style>body{font-family:sans-serif;margin:20px}svg{margin:0 16px 16px 0}</style></head><body>\n");
+        std::fprintf(file, "<h1>Scaling sweep</h1>\n<p>%d timed ticks per point after %d warmup ticks, %u hardware threads. "
+            "Red rings: ns per cell more than %.1fx the next smaller grid's, or more workers that are less than %.0f%% faster. "
+            "Efficiency compares the striped engine with itself on its fewest workers; the serial line is a reference that moves grains "
+            "differently at stripe borders. Worker counts above the stripes one pass runs at once (half the chunk rows) are not measured. "
+            "Hover a point for all its numbers.</p>\n", options.ticks, options.warmup, std::thread::hardware_concurrency(),
+            GRID_CLIFF_RATIO, (WORKER_CLIFF_GAIN - 1.0) * 100.0);
+
+        std::vector<std::string> gridColumns, workerColumns;
+        for (const SweepOptions::GridSize& grid : options.grids) { gridColumns.push_back(std::to_string(grid.width) + "x" + std::to_string(grid.height)); }
+        for (int workers : options.threads) { workerColumns.push_back(std::to_string(workers)); }
+
+        const double NONE = std::nan("");
+        for (int scenario : options.scenarios) {
+            std::fprintf(file, "<h2>%s</h2>\n<div>\n", Scenario::NAMES[scenario]);
+
+            // Cost per cell against the grid size, one line per engine and worker count
+            std::vector<Series> byGrid;
+            for (int line = -1; line < (int)options.threads.size(); ++line) {
+                Series series;
+                series.name = (line < 0) ? std::string("serial") : ("striped x" + std::to_string(options.threads[line]));
+                series.color = (line < 0) ? "#7f7f7f" : SERIES_COLORS[line % (sizeof(SERIES_COLORS) / sizeof(SERIES_COLORS[0]))];
+                series.dashed = (line < 0);
+                for (const SweepOptions::GridSize& grid : options.grids) {
+                    const Point* point = (line < 0) ? findPoint(points, scenario, grid, Simulation::ENGINE_SERIAL, 1)
+                        : findPoint(points, scenario, grid, Simulation::ENGINE_STRIPED, options.threads[line]);
+                    series.values.push_back(point ? point->nsPerCell : NONE);
+                    series.cliffs.push_back(point && point->gridCliff);
+                    series.notes.push_back(point ? describe(*point) : "");
+                }
+                byGrid.push_back(series);
+            }
+            writeSvg(file, "ns per cell by grid size", gridColumns, byGrid, 0.0);
+
+            // Efficiency against the worker count, one line per grid, perfect scaling stays at 1
+            std::vector<Series> byWorkers;
+            Series ideal;
+            ideal.name = "ideal";
+            ideal.color = "#7f7f7f";
+            ideal.dashed = true;
+            ideal.values.assign(options.threads.size(), 1.0);
+            byWorkers.push_back(ideal);
+            for (size_t line = 0; line < options.grids.size(); ++line) {
+                Series series;
+                series.name = gridColumns[line];
+                series.color = SERIES_COLORS[line % (sizeof(SERIES_COLORS) / sizeof(SERIES_COLORS[0]))];
+                series.dashed = false;
+                for (int workers : options.threads) {
+                    const Point* point = findPoint(points, scenario, options.grids[line], Simulation::ENGINE_STRIPED, workers);
+                    series.values.push_back(point ? point->efficiency : NONE);
+                    series.cliffs.push_back(point && point->workerCliff);
+                    series.notes.push_back(point ? describe(*point) : "");
+                }
+                byWorkers.push_back(series);
+            }
+            writeSvg(file, "parallel efficiency by workers", workerColumns, byWorkers, 1.0);
+            std::fprintf(file, "</div>\n");
+        }
+        std::fprintf(file, "</body></html>\n");
+
+        bool ok = !std::ferror(file);
+        std::fclose(file);
+        return ok;
+    }
+}
+
+bool SweepOptions::parse(int argc, char** argv)
+{
+    grids.assign(DEFAULT_GRIDS, DEFAULT_GRIDS + sizeof(DEFAULT_GRIDS) / sizeof(DEFAULT_GRIDS[0]));
+    int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int workers = 1; workers < cores; workers *= 2) { threads.push_back(workers); }
+    threads.push_back(cores);
+    for (int id = 0; id < Scenario::SCENARIO_COUNT; ++id) { scenarios.push_back(id); }
+    outPath = SWEEP_REPORT_PATH;
+    chartPath = SWEEP_CHART_PATH;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--sweep") == 0) { continue; }
+
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            std::cerr << "Error: Missing value for " << arg << "\n";
+            return false;
+        }
+
+        bool ok = true;
+        if (std::strcmp(arg, "--grid") == 0) {
+            grids.clear();
+            for (const char* part = value; ok && *part != '\0';) {
+                GridSize grid;
+                int length = 0;
+                ok = std::sscanf(part, "%dx%d%n", &grid.width, &grid.height, &length) == 2 && grid.width > 0 && grid.height > 0;
+                grids.push_back(grid);
+                part += length;
+                if (*part == ',') { ++part; }
+                else if (*part != '\0') { ok = false; }
+            }
+        }
+        else if (std::strcmp(arg, "--threads") == 0) { ok = parseList(value, threads); }
+        else if (std::strcmp(arg, "--scenario") == 0) {
+            if (!parseNames(value, "scenario", Scenario::NAMES, Scenario::SCENARIO_COUNT, scenarios)) { return false; }
+        }
+        else if (std::strcmp(arg, "--warmup") == 0) { warmup = std::max(0, std::atoi(value)); }
+        else if (std::strcmp(arg, "--ticks") == 0) { ticks = std::max(1, std::atoi(value)); }
+        else if (std::strcmp(arg, "--out") == 0) { outPath = value; }
+        else if (std::strcmp(arg, "--chart") == 0) { chartPath = value; }
+        else { ok = false; }
+
+        if (!ok) {
+            std::cerr << "Error: Bad option " << arg << " " << value << "\n";
+            return false;
+        }
+        ++i;
+    }
+
+    // Cliffs compare each grid with the next smaller one and each worker count with the next lower one
+    std::stable_sort(grids.begin(), grids.end(), [](const GridSize& a, const GridSize& b) { return (double)a.width * a.height < (double)b.width * b.height; });
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+    return true;
+}
+
+int runSweep(int argc, char** argv)
+{
+    SweepOptions options;
+    if (!options.parse(argc, argv)) { return 1; }
+
+    std::printf("%-16s %11s %-8s %3s %11s %11s %9s %9s %8s %8s\n", "scenario", "grid", "engine", "thr", "ticks/s", "ns/cell", "chunk MB", "GB/s", "speedup", "eff");
+    std::vector<std::string> skipped;
+    std::vector<Point> points;
+
+    // One pool per worker count for the whole sweep, so every point runs on the same warm threads
+    std::vector<std::unique_ptr<ThreadPool>> pools;
+    for (int workers : options.threads) { pools.emplace_back(new ThreadPool(workers)); }
+
+    for (const SweepOptions::GridSize& grid : options.grids) {
+        for (int scenario : options.scenarios) {
+            size_t first = points.size();
+            points.push_back(measure(scenario, grid, Simulation::ENGINE_SERIAL, nullptr, options));
+            for (size_t poolIndex = 0; poolIndex < pools.size(); ++poolIndex) {
+                int workers = options.threads[poolIndex];
+                int stripes = Simulation::getStripesPerPass(grid.height);
+                if (workers > 1 && workers > stripes) {
+                    char text[128];
+                    std::snprintf(text, sizeof(text), "%dx%d x%d: a pass has %d stripe(s), the extra workers would only idle", grid.width, grid.height, workers, stripes);
+                    if (std::find(skipped.begin(), skipped.end(), text) == skipped.end()) { skipped.push_back(text); }
+                    continue;
+                }
+                points.push_back(measure(scenario, grid, Simulation::ENGINE_STRIPED, pools[poolIndex].get(), options));
+            }
+            compareWorkers(points, first);
+
+            for (size_t i = first; i < points.size(); ++i) {
+                const Point& point = points[i];
+                char gridText[32];
+                std::snprintf(gridText, sizeof(gridText), "%dx%d", grid.width, grid.height);
+                std::printf("%-16s %11s %-8s %3d %11.2f %11.4f %9.1f %9.2f %8s %8s\n", Scenario::NAMES[scenario], gridText,
+                    Simulation::ENGINE_NAMES[point.engine], point.workers, point.ticksPerSecond, point.nsPerCell, point.chunkMB,
+                    point.chunkGBps, formatRatio(point.speedup, "%.2f").c_str(), formatRatio(point.efficiency * 100.0, "%.0f%%").c_str());
+            }
+            std::fflush(stdout);
+        }
+    }
+    findGridCliffs(points);
+
+    if (!skipped.empty()) { std::printf("\nSkipped:\n"); }
+    for (const std::string& text : skipped) { std::printf("  %s\n", text.c_str()); }
+
+    int cliffs = 0;
+    for (const Point& point : points) {
+        if (!point.gridCliff && !point.workerCliff) { continue; }
+        if (cliffs++ == 0) { std::printf("\nCliffs:\n"); }
+        std::printf("  %s\n", describe(point).c_str());
+    }
+
+    if (!writeCsv(options.outPath.c_str(), options, points)) {
+        std::cerr << "Error: Cannot write " << options.outPath << "\n";
+        return 1;
+    }
+    if (!writeChart(options.chartPath.c_str(), options, points)) {
+        std::cerr << "Error: Cannot write " << options.chartPath << "\n";
+        return 1;
+    }
+    std::printf("\nWrote %s and %s\n", options.outPath.c_str(), options.chartPath.c_str());
+    return 0;
+}
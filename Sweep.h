@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// `SandboxGL --sweep [options]`: how the simulation scales with grid size and worker count.
+// Every scenario runs on every grid, once on the serial engine and once on the striped engine
+// per worker count, and the timed ticks give ticks/s, ns per cell, chunk memory and parallel
+// efficiency. Speedup and efficiency compare the striped engine with itself on its fewest
+// workers; the serial engine is only a reference, its ticks move grains differently at stripe
+// borders. Worker counts above the stripes a pass can run at once are skipped. Results are
+// written as CSV and as an HTML page with one SVG chart per axis, where points that fall off a
+// cliff (ns per cell jumping with the grid, or workers that stop paying off) are circled in red.
+//   --grid WxH[,WxH]       grid sizes (default 460x460 up to 8192x8192)
+//   --threads T[,T]        worker counts of the striped engine (default 1, 2, 4, ... up to every core)
+//   --scenario NAME[,NAME] scenarios to run (default all of them)
+//   --warmup N             untimed ticks after setUp (default 5)
+//   --ticks N              timed ticks per point (default 30)
+//   --out PATH             CSV results (default SWEEP_REPORT_PATH)
+//   --chart PATH           HTML charts (default SWEEP_CHART_PATH)
+struct SweepOptions {
+	struct GridSize { int width, height; };
+
+	std::vector<GridSize> grids;
+	std::vector<int> threads;
+	std::vector<int> scenarios;
+	int warmup = 5;
+	int ticks = 30;
+	std::string outPath;
+	std::string chartPath;
+
+	bool parse(int argc, char** argv);
+};
+
+int runSweep(int argc, char** argv);
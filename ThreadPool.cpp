@@ -0,0 +1,84 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount <= 0) {
+        threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    // Set before any worker starts, they split ranges by it
+    _threadCount = threadCount;
+    _workers.reserve(threadCount - 1);
+    for (int i = 1; i < threadCount; ++i) {
+        _workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int begin, int end)>& body)
+{
+    int ranges = std::min(count, getThreadCount());
+    if (ranges <= 1) {
+        body(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _body = &body;
+        _count = count;
+        _ranges = ranges;
+        _pending = (int)_workers.size();
+        _generation++;
+    }
+    _wake.notify_all();
+
+    {
+        PROFILE_ZONE("parallel range");
+        body(0, count / ranges);
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _pending == 0; });
+    _body = nullptr;
+}
+
+void ThreadPool::workerLoop(int index)
+{
+    uint64_t seenGeneration = 0;
+    PROFILE_THREAD("pool worker");
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait(lock, [&] { return _stopping || _generation != seenGeneration; });
+        if (_stopping) { return; }
+        seenGeneration = _generation;
+
+        const std::function<void(int, int)>& body = *_body;
+        int ranges = _ranges;
+        int begin = (int)((int64_t)_count * index / ranges);
+        int end = (int)((int64_t)_count * (index + 1) / ranges);
+        lock.unlock();
+
+        if (index < ranges) {
+            PROFILE_ZONE("parallel range");
+            body(begin, end);
+        }
+
+        lock.lock();
+        if (--_pending == 0) { _done.notify_one(); }
+    }
+}
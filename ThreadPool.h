@@ -0,0 +1,39 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers for data-parallel loops. parallelFor blocks until every range
+// is done, the calling thread takes the first range itself.
+class ThreadPool
+{
+public:
+	ThreadPool(int threadCount = 0); // 0 picks one thread per hardware thread
+	~ThreadPool();
+
+	int getThreadCount() { return _threadCount; }
+
+	// Splits [0, count) into one contiguous range per thread, fewer items than threads leave the rest idle
+	void parallelFor(int count, const std::function<void(int begin, int end)>& body);
+
+private:
+	int _threadCount;
+	std::vector<std::thread> _workers;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+
+	// Current job, guarded by _mutex
+	const std::function<void(int, int)>* _body = nullptr;
+	int _count = 0;
+	int _ranges = 0; // Threads that get a range, min(count, thread count)
+	int _pending = 0;
+	uint64_t _generation = 0;
+	bool _stopping = false;
+
+	void workerLoop(int index);
+};
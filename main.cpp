@@ -5,44 +5,50 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
-#include <vector>
-#include <string>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+#include <random>
 
-#include "Shaders/Shader.h"
 #include "Objects/SandboxGUI.h"
 #include "Config.h"
 #include "InputManager.h"
 #include "Simulation.h"
+#include "FrameArena.h"
+#include "MemoryTracker.h"
+#include "Renderer.h"
+#include "Camera.h"
+#include "Headless.h"
+#include "Offscreen.h"
+#include "Microbench.h"
+#include "Sweep.h"
+#include "Determinism.h"
+#include "FrameCapture.h"
+#include "FrameStats.h"
+#include "FramePacer.h"
+#include "LatencyTracker.h"
+#include "Profiler.h"
+#include "PerfCounters.h"
+#include "Scenario.h"
 
 GLFWwindow* window;
 Simulation* sim = new Simulation();
+FrameArena* frameArena = new FrameArena(FRAME_ARENA_SIZE);
+Camera* camera = new Camera();
 
-unsigned int quadVBO, instancePositionVBO, tileTypeVBO;
-
-float unitQuad[] = {
-    -0.5f,  0.5f, 0.0f,  // Top Left
-	-0.5f, -0.5f, 0.0f,  // Bottom Left 
-     0.5f, -0.5f, 0.0f,  // Bottom Right
-
-    -0.5f,  0.5f, 0.0f,  // Top Left
-     0.5f,  0.5f, 0.0f,  // Top Right
-	 0.5f, -0.5f, 0.0f   // Bottom Right
-};
-Shader* myShader = NULL;
 SandboxGUI* sandboxGui;
+Renderer* renderer;
 
-void sendDataToGPU() {
-    glBindBuffer(GL_ARRAY_BUFFER, instancePositionVBO);
-    glBufferData(GL_ARRAY_BUFFER, sim->getCellPositions().size() * sizeof(glm::vec2),
-        sim->getCellPositions().data(), GL_DYNAMIC_DRAW);
-
-    glBindBuffer(GL_ARRAY_BUFFER, tileTypeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sim->getCellTypes().size() * sizeof(Simulation::TileType),
-        sim->getCellTypes().data(), GL_DYNAMIC_DRAW);
-}
-
-int main()
+int main(int argc, char** argv)
 {
+    if (argc > 1 && std::strcmp(argv[1], "--headless") == 0) { return runHeadless(argc, argv); }
+    if (argc > 1 && std::strcmp(argv[1], "--offscreen") == 0) { return runOffscreen(argc, argv); }
+    if (argc > 1 && std::strcmp(argv[1], "--microbench") == 0) { return runMicrobench(argc, argv); }
+    if (argc > 1 && std::strcmp(argv[1], "--sweep") == 0) { return runSweep(argc, argv); }
+    if (argc > 1 && std::strcmp(argv[1], "--determinism") == 0) { return runDeterminismCheck(argc, argv); }
+    BenchmarkOptions benchmark;
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0 && !benchmark.parse(argc, argv)) { return 1; }
+
     /*Initialize GLFW*/
 
     glfwInit();
@@ -59,7 +65,7 @@ int main()
         glfwTerminate();
         return -1;
     }
-    InputManager* inputManager = new InputManager(window, sim);
+    InputManager* inputManager = new InputManager(window, sim, camera);
 
     // Callback Events
     glfwMakeContextCurrent(window);
@@ -72,83 +78,238 @@ int main()
 
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-    // Create Shader
-	myShader = new Shader();
-    myShader->attachShader("./Shaders/shadervs.glsl", GL_VERTEX_SHADER);
-    myShader->attachShader("./Shaders/shaderfs.glsl", GL_FRAGMENT_SHADER);
-    myShader->link();
-
     //Create GUI
     sandboxGui = new SandboxGUI(window);
 
-    // VAO & VBO
-
-    unsigned int VAO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glGenBuffers(1, &instancePositionVBO);
-	glGenBuffers(1, &tileTypeVBO);
-	glGenBuffers(1, &quadVBO);
-
-	sim->calculateInstanceData();
-
-    // quadVBO
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(unitQuad), unitQuad, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribDivisor(0, 0);
-
-    // instancePositionVBO
-    glBindBuffer(GL_ARRAY_BUFFER, instancePositionVBO);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribDivisor(1, 1);
-
-    // tileTypeVBO
-    glBindBuffer(GL_ARRAY_BUFFER, tileTypeVBO);
-    glVertexAttribIPointer(2, 1, GL_INT, sizeof(Simulation::TileType), (void*)0);
-    glEnableVertexAttribArray(2);
-    glVertexAttribDivisor(2, 1);
-
-    glBindVertexArray(VAO);
-
-    // Use Shader
-    int cellSizeLocation = myShader->getUniformLocation("uCellSize");
-    myShader->use();
-
-    glUniform1f(cellSizeLocation, sim->getCellSize());
-
-    glfwSwapInterval(1);
+    // Create Renderer
+    double rendererStart = glfwGetTime();
+    renderer = new Renderer(sim, camera);
+    if (benchmark.enabled) {
+        std::cout << "Renderer ready in " << int((glfwGetTime() - rendererStart) * 1000.0) << " ms ("
+            << Shader::getCacheHits() << " cached programs, " << Shader::getCacheMisses() << " compiled)\n";
+    }
+    int renderMode = renderer->getMode();
+    LatencyTracker* latency = new LatencyTracker();
+    PerfCounters* perf = new PerfCounters();
+    sim->setPerfCounters(perf);
+    inputManager->setLatencyTracker(latency);
+
+    // Benchmarks measure throughput, vsync would cap them at the display refresh
+    glfwSwapInterval(benchmark.enabled ? 0 : 1);
+    FramePacer pacer(benchmark.fpsCap);
+    FrameStats frameStats;
+    std::mt19937 benchmarkRng(benchmark.seed);
+    Scenario* scenario = nullptr;
+    int scenarioIndex = (benchmark.scenario >= 0) ? benchmark.scenario : 0;
+    bool loadScenario = (benchmark.scenario >= 0);
+    char scenarioStatus[256] = "";
+    int benchmarkFrame = 0;
+    int benchmarkLength = (benchmark.frames > 0) ? STEADY_STATE_WARMUP_FRAMES + benchmark.frames : INT_MAX;
 
     /*Window loop*/
 
+    int frameIndex = 0;
+    FrameCapture* capture = nullptr;
+    int capturedFrame = 0;
+    int redrawFrames = IDLE_REDRAW_FRAMES;
+    double lastFrameStart = glfwGetTime();
     while (!glfwWindowShouldClose(window))
     {
-
-        
-        if (!(sandboxGui->io->WantCaptureMouse && sandboxGui->io->MouseDown)) { inputManager->processInput(window); }
-
+        // Minimized: nothing to show, the world waits until the window comes back
+        if (!benchmark.enabled && glfwGetWindowAttrib(window, GLFW_ICONIFIED)) {
+            glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
+            continue;
+        }
+
+        // Settled world, no input and no recording: leave the last frame on screen and sleep
+        if (inputManager->consumeActivity() || !sim->isSettled() || capture != nullptr || benchmark.enabled) {
+            redrawFrames = IDLE_REDRAW_FRAMES;
+        }
+        if (redrawFrames == 0) {
+            glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
+            continue;
+        }
+        redrawFrames--;
+
+        // Unfocused: hold the loop to UNFOCUSED_FRAME_RATE, input that arrives meanwhile waits for the frame
+        if (!benchmark.enabled && !glfwGetWindowAttrib(window, GLFW_FOCUSED)) {
+            double frameEnd = lastFrameStart + 1.0 / UNFOCUSED_FRAME_RATE;
+            for (double now = glfwGetTime(); now < frameEnd && !glfwWindowShouldClose(window); now = glfwGetTime()) {
+                glfwWaitEventsTimeout(frameEnd - now);
+            }
+        }
+        lastFrameStart = glfwGetTime();
+
+        MemoryTracker::beginFrame();
+        if (benchmark.enabled && benchmarkFrame == STEADY_STATE_WARMUP_FRAMES) { frameStats.reset(); } // Measure after the warmup
+        frameStats.beginFrame();
+        latency->beginFrame();
+        // Opening the trace file allocates its stream buffer, so the warmup starts over
+        if (inputManager->traceRequested) {
+            inputManager->traceRequested = false;
+            if (!Profiler::isTracing() && !Profiler::startTrace(TRACE_PATH, TRACE_FRAMES)) {
+                std::cout << "Failed to start a trace in " << TRACE_PATH << (Profiler::isEnabled() ? "" : ", profiling is compiled out") << "\n";
+            }
+            frameIndex = 0;
+        }
+        Profiler::beginFrame();
+
+        {
+            PROFILE_ZONE("input");
+            if (!(sandboxGui->io->WantCaptureMouse && sandboxGui->io->MouseDown)) { inputManager->processInput(window); }
+        }
+        frameStats.mark(FrameStats::PHASE_INPUT);
+
+        // Loading a scenario rewrites the grid and wakes its chunks, so the warmup starts over
+        if (loadScenario) {
+            loadScenario = false;
+            delete scenario;
+            scenario = new Scenario((Scenario::Id)scenarioIndex, benchmark.seed);
+            scenario->setUp(*sim);
+            scenarioStatus[0] = '\0';
+            frameIndex = 0;
+        }
+        // Same workload every run
+        if (scenario != nullptr) { scenario->update(*sim); }
+        else if (benchmark.enabled) { spawnHeadlessGrains(*sim, benchmarkRng, benchmarkFrame, benchmarkLength); }
+        if (benchmark.enabled) { benchmarkFrame++; }
         sim->update();
+        latency->onSimulation(sim->getTickCount());
+        frameStats.mark(FrameStats::PHASE_SIMULATION);
         sandboxGui->update();
-        sendDataToGPU();
+        renderer->upload();
+        latency->onUpload();
+        PROFILE_COUNTER("instances", renderer->getInstanceCount());
+        PROFILE_COUNTER("uploaded bytes", renderer->getUploadedBytes());
+        frameStats.mark(FrameStats::PHASE_UPLOAD);
 
         /*Clear Window*/
-        glClearColor(0.2f, 0.3f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);       
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, sim->getInstanceCount());
-
-        sandboxGui->addText("FPS: " + std::to_string(int(sim->getFPS())));
-        sandboxGui->addText("Instance Count: " + std::to_string(int(sim->getInstanceCount())));
-        sandboxGui->addText("Type: " + sim->getTileName(inputManager->selectedType));
+        glClearColor(CLEAR_COLOR[0], CLEAR_COLOR[1], CLEAR_COLOR[2], CLEAR_COLOR[3]);
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderer->draw();
+        frameStats.mark(FrameStats::PHASE_DRAW);
+
+        {
+            PROFILE_ZONE("capture");
+            // Starting or stopping a recording allocates its buffers, so the warmup starts over
+            if (inputManager->recording != (capture != nullptr)) {
+                if (capture == nullptr) {
+                    int framebufferWidth, framebufferHeight;
+                    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+                    capture = new FrameCapture(CAPTURE_PATH, framebufferWidth, framebufferHeight);
+                    capturedFrame = 0;
+                }
+                else {
+                    capture->finish();
+                    delete capture;
+                    capture = nullptr;
+                }
+                frameIndex = 0;
+            }
+            if (capture != nullptr) { capture->capture(++capturedFrame); }
+        }
+        frameStats.mark(FrameStats::PHASE_CAPTURE);
+
+        sandboxGui->addText(frameArena->format("FPS: %d", int(sim->getFPS())));
+        TimeHistogram& frameTimes = frameStats.getHistogram(FrameStats::PHASE_FRAME);
+        sandboxGui->addText(frameArena->format("Frame: %.2f ms p50, %.2f ms p99, %.2f ms max%s",
+            frameTimes.getPercentile(50.0), frameTimes.getPercentile(99.0), frameTimes.getMax(), benchmark.enabled ? " (benchmark)" : ""));
+        if (latency->getHistogram(LatencyTracker::STAGE_SWAP).getCount() > 0) {
+            sandboxGui->addText(frameArena->format("Brush latency, p50/p99 ms over %d strokes:",
+                latency->getHistogram(LatencyTracker::STAGE_SWAP).getCount()));
+            for (int stage = 0; stage < LatencyTracker::STAGE_COUNT; ++stage) {
+                if (stage == LatencyTracker::STAGE_GPU && !latency->hasGpuTimestamps()) { continue; }
+                TimeHistogram& histogram = latency->getHistogram((LatencyTracker::Stage)stage);
+                sandboxGui->addText(frameArena->format("  to %-7s %6.1f / %6.1f", LatencyTracker::STAGE_NAMES[stage],
+                    histogram.getPercentile(50.0), histogram.getPercentile(99.0)));
+            }
+        }
+        if (perf->getRecent().samples > 0) {
+            char perfText[256];
+            perf->format(perf->getRecent(), perfText, sizeof(perfText));
+            sandboxGui->addText(frameArena->format("Tick: %s", perfText));
+        }
+        sandboxGui->addText(frameArena->format("Instance Count: %d", renderer->getInstanceCount()));
+        sandboxGui->addText(frameArena->format("Upload: %zu KB/frame", renderer->getUploadedBytes() / 1024));
+        sandboxGui->addText(frameArena->format("Camera: %.2fx, %d chunks visible, LOD %d",
+            camera->getZoom(), renderer->getVisibleChunkCount(), renderer->getLod()));
+        if (capture != nullptr) {
+            sandboxGui->addText(frameArena->format("Recording: %d frames, %.2f ms/frame, %d stalls%s",
+                capture->getWrittenFrames(), capture->getAverageCaptureMs(), capture->getStalls(),
+                capture->hasFailed() ? ", WRITE FAILED" : ""));
+        }
+        sandboxGui->addText(frameArena->format("Type: %s", sim->getTileName(inputManager->selectedType)));
+        ChunkAllocator::Stats chunkStats = sim->getChunkStats();
+        sandboxGui->addText(frameArena->format("Chunks: %zu live, %zu peak, %zu KB",
+            chunkStats.liveBlocks, chunkStats.highWaterBlocks, chunkStats.liveBytes / 1024));
+        if (MemoryTracker::isEnabled()) {
+            sandboxGui->addText(frameArena->format("Heap allocs last frame: %zu", MemoryTracker::getFrameAllocations()));
+        }
+        if (MemoryTracker::isTrackingBytes()) {
+            MemoryTracker::setExternalBytes(MemoryTracker::TAG_SIMULATION, chunkStats.reservedBytes);
+            sandboxGui->addText(frameArena->format("Heap: %zu KB live, %zu KB peak",
+                MemoryTracker::getLiveBytes() / 1024, MemoryTracker::getPeakBytes() / 1024));
+            for (int tag = 0; tag < MemoryTracker::TAG_COUNT; ++tag) {
+                MemoryTracker::TagStats tagStats = MemoryTracker::getTagStats((MemoryTracker::Tag)tag);
+                sandboxGui->addText(frameArena->format("  %-13s %7zu KB (+%zu KB mapped), %zu allocs/frame",
+                    MemoryTracker::getTagName((MemoryTracker::Tag)tag), tagStats.liveBytes / 1024,
+                    tagStats.externalBytes / 1024, tagStats.frameAllocations));
+            }
+        }
+        if (Profiler::isTracing()) { sandboxGui->addText(frameArena->format("Tracing to %s", TRACE_PATH)); }
+        if (Profiler::isEnabled()) { sandboxGui->addProfilerGraph(FRAME_BUDGET_MS); }
         sandboxGui->addIntSlider("Brush Size", BRUSH_SIZE, 1, 50);
         sandboxGui->addFloatSlider("Brush Density", BRUSH_DENSITY, 0.005f, 0.05f);
+        if (sandboxGui->addCombo("Renderer", renderMode, Renderer::MODE_NAMES, Renderer::RENDER_MODE_COUNT)) {
+            renderer->setMode((Renderer::RenderMode)renderMode);
+        }
+        sandboxGui->addCombo("Scenario", scenarioIndex, Scenario::NAMES, Scenario::SCENARIO_COUNT);
+        if (sandboxGui->addButton("Load")) { loadScenario = true; }
+        if (scenario != nullptr) {
+            if (sandboxGui->addButton("Check", true)) {
+                std::string failure;
+                bool ok = scenario->check(*sim, failure);
+                std::snprintf(scenarioStatus, sizeof(scenarioStatus), "%s at tick %u%s%s", ok ? "OK" : "FAILED", sim->getTickCount(),
+                    ok ? "" : ": ", failure.c_str());
+            }
+            sandboxGui->addText(frameArena->format("%s: %s", scenario->getName(), Scenario::EXPECTED[scenario->getId()]));
+            if (scenarioStatus[0] != '\0') { sandboxGui->addText(scenarioStatus); }
+        }
 		sandboxGui->render();
+        frameStats.mark(FrameStats::PHASE_GUI);
+        Profiler::endFrame(); // The budget covers the frame's work, not the wait for vsync
 
+        latency->onSubmit();
         glfwSwapBuffers(window);
+        latency->onSwap();
+        frameStats.mark(FrameStats::PHASE_PRESENT);
         glfwPollEvents();
-           
+        pacer.wait();
+        frameStats.mark(FrameStats::PHASE_PACING);
+        frameStats.endFrame();
+
+        if (benchmark.enabled && benchmarkFrame >= benchmarkLength) { glfwSetWindowShouldClose(window, true); }
+
+        frameArena->reset();
+        MemoryTracker::endFrame(++frameIndex > STEADY_STATE_WARMUP_FRAMES);
+    }
+
+    delete capture; // Flushes the frames still in flight
+    delete scenario;
+    Profiler::stopTrace();
+    delete latency;
+    sim->setPerfCounters(nullptr);
+    delete perf;
+
+    if (benchmark.enabled) {
+        frameStats.printSummary();
+        if (!frameStats.writeReport(benchmark.reportPath.c_str(), benchmark, Renderer::MODE_NAMES[renderer->getMode()])) {
+            std::cout << "Failed to write " << benchmark.reportPath << "\n";
+        }
+    }
+
+    if (MemoryTracker::isEnabled()) {
+        MemoryTracker::writeReport(MEMORY_REPORT_PATH);
     }
 
     sandboxGui->destroy();